@@ -0,0 +1,401 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "MapCache.hpp"
+
+#include "../../../src/cs-utils/logger.hpp"
+#include "logger.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <ctime>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Accesses are only logged if the previous one is at least this many seconds ago. Otherwise, the
+// log would grow with every texture which is loaded from the cache.
+const int64_t ACCESS_RESOLUTION = 60;
+
+// The log is compacted once it contains more than twice as many records as there are entries plus
+// this amount.
+const size_t MIN_OUTDATED_RECORDS = 1000;
+
+// The log consists of one record per line. The file name is always the last field, as it may
+// contain spaces:
+//   + <size> <last access> <file>   A file has been added to the cache.
+//   * <last access> <file>          A file has been accessed.
+//   - <file>                        A file has been removed from the cache.
+const char INSERT_RECORD = '+';
+const char ACCESS_RECORD = '*';
+const char REMOVE_RECORD = '-';
+
+// Parses an integer followed by a space at the beginning of the given line and removes both.
+template <typename T>
+bool parseField(std::string_view& line, T& value) {
+  char const* end    = line.data() + line.size();
+  auto        result = std::from_chars(line.data(), end, value);
+
+  if (result.ec != std::errc() || result.ptr == end || *result.ptr != ' ') {
+    return false;
+  }
+
+  line.remove_prefix(static_cast<size_t>(result.ptr - line.data()) + 1);
+  return true;
+}
+
+int64_t now() {
+  return static_cast<int64_t>(std::time(nullptr));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::string MapCache::INDEX_FILE = "index.log";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MapCache::MapCache(std::string directory)
+    : mDirectory(std::move(directory)) {
+  while (mDirectory.size() > 1 && mDirectory.back() == '/') {
+    mDirectory.pop_back();
+  }
+
+  boost::system::error_code error;
+  boost::filesystem::create_directories(mDirectory, error);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // Caches which have been created before the index existed are scanned once. The log is also
+  // rewritten if its last record is incomplete, as new records would be appended to it.
+  bool complete = true;
+  if (!readLog(complete)) {
+    scanDirectory();
+    writeLog();
+  } else if (!complete || mRecords > 2 * mEntries.size() + MIN_OUTDATED_RECORDS) {
+    writeLog();
+  } else {
+    mLog.open(mDirectory + "/" + INDEX_FILE, std::ofstream::app | std::ofstream::binary);
+  }
+
+  logger().debug("Opened map cache '{}' with {} files ({} MB).", mDirectory, mEntries.size(),
+      mTotalSize / 1024 / 1024);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MapCache::~MapCache() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLog.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::setQuota(uint64_t bytes) {
+  mQuota = bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MapCache::touch(std::string const& fileName) {
+  std::string key  = getKey(fileName);
+  int64_t     time = now();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto entry = mEntries.find(key);
+  if (entry == mEntries.end()) {
+    return false;
+  }
+
+  if (time - entry->second.mLastAccess >= ACCESS_RESOLUTION) {
+    entry->second.mLastAccess = time;
+    mLog << ACCESS_RECORD << ' ' << time << ' ' << key << '\n';
+    ++mRecords;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::insert(std::string const& fileName, uint64_t size) {
+  std::string key  = getKey(fileName);
+  int64_t     time = now();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Entry& entry = mEntries[key];
+  mTotalSize   = mTotalSize - entry.mSize + size;
+  entry        = {size, time};
+
+  mLog << INSERT_RECORD << ' ' << size << ' ' << time << ' ' << key << '\n';
+  mLog.flush();
+  ++mRecords;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::remove(std::string const& fileName) {
+  std::string key = getKey(fileName);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto entry = mEntries.find(key);
+  if (entry == mEntries.end()) {
+    return;
+  }
+
+  mTotalSize -= entry->second.mSize;
+  mEntries.erase(entry);
+
+  mLog << REMOVE_RECORD << ' ' << key << '\n';
+  mLog.flush();
+  ++mRecords;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MapCache::requestMaintenance() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!needsMaintenance()) {
+      return false;
+    }
+  }
+
+  return !mMaintaining.exchange(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::maintain() {
+  uint64_t quota = mQuota;
+
+  // The files are deleted until the cache is at 90% of its quota, so that eviction does not run
+  // again after every download.
+  uint64_t                                     excess = 0;
+  std::vector<std::pair<int64_t, std::string>> candidates;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (quota > 0 && mTotalSize > quota) {
+      excess = mTotalSize - quota / 10 * 9;
+      candidates.reserve(mEntries.size());
+      for (auto const& [key, entry] : mEntries) {
+        candidates.emplace_back(entry.mLastAccess, key);
+      }
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+
+  size_t   removedFiles = 0;
+  uint64_t removedBytes = 0;
+
+  for (auto const& [lastAccess, key] : candidates) {
+    if (removedBytes >= excess) {
+      break;
+    }
+
+    // The file is deleted while the lock is held, so that it cannot be looked up in between.
+    // Files which have been used since the candidates were collected are kept.
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto entry = mEntries.find(key);
+    if (entry == mEntries.end() || entry->second.mLastAccess != lastAccess) {
+      continue;
+    }
+
+    removedBytes += entry->second.mSize;
+    mTotalSize -= entry->second.mSize;
+    mEntries.erase(entry);
+
+    mLog << REMOVE_RECORD << ' ' << key << '\n';
+    ++mRecords;
+
+    boost::system::error_code error;
+    boost::filesystem::remove(mDirectory + "/" + key, error);
+    ++removedFiles;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLog.flush();
+
+    if (mRecords > 2 * mEntries.size() + MIN_OUTDATED_RECORDS) {
+      writeLog();
+    }
+  }
+
+  if (removedFiles > 0) {
+    logger().info("Removed {} least recently used files ({} MB) from map cache '{}'.",
+        removedFiles, removedBytes / 1024 / 1024, mDirectory);
+  }
+
+  mMaintaining = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string MapCache::getKey(std::string const& fileName) const {
+  if (fileName.compare(0, mDirectory.size(), mDirectory) != 0) {
+    return fileName;
+  }
+
+  size_t start = fileName.find_first_not_of('/', mDirectory.size());
+  return start == std::string::npos ? "" : fileName.substr(start);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MapCache::readLog(bool& complete) {
+  std::ifstream in(mDirectory + "/" + INDEX_FILE, std::ifstream::binary);
+  if (!in) {
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    // The last record is incomplete if the application was killed while writing it.
+    if (in.eof()) {
+      complete = false;
+      break;
+    }
+
+    ++mRecords;
+
+    if (line.size() < 2 || line[1] != ' ') {
+      continue;
+    }
+
+    std::string_view fields(line);
+    fields.remove_prefix(2);
+
+    if (line[0] == INSERT_RECORD) {
+      Entry entry;
+      if (parseField(fields, entry.mSize) && parseField(fields, entry.mLastAccess)) {
+        Entry& existing = mEntries[std::string(fields)];
+        mTotalSize      = mTotalSize - existing.mSize + entry.mSize;
+        existing        = entry;
+      }
+    } else if (line[0] == ACCESS_RECORD) {
+      int64_t lastAccess = 0;
+      if (parseField(fields, lastAccess)) {
+        auto entry = mEntries.find(std::string(fields));
+        if (entry != mEntries.end()) {
+          entry->second.mLastAccess = lastAccess;
+        }
+      }
+    } else if (line[0] == REMOVE_RECORD) {
+      auto entry = mEntries.find(std::string(fields));
+      if (entry != mEntries.end()) {
+        mTotalSize -= entry->second.mSize;
+        mEntries.erase(entry);
+      }
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::scanDirectory() {
+  boost::filesystem::path root(mDirectory);
+  boost::filesystem::path quarantineDir = root / "quarantine";
+  boost::system::error_code error;
+
+  if (!boost::filesystem::exists(root, error)) {
+    return;
+  }
+
+  logger().info("Building index of map cache '{}'...", mDirectory);
+
+  std::string prefix = root.generic_string() + "/";
+
+  for (boost::filesystem::recursive_directory_iterator it(root, error), end;
+       !error && it != end; it.increment(error)) {
+    if (it->path() == quarantineDir) {
+      it.no_push();
+      continue;
+    }
+
+    if (!boost::filesystem::is_regular_file(it->status()) || it->path().extension() == ".tmp" ||
+        it->path().parent_path() == root) {
+      continue;
+    }
+
+    boost::system::error_code fileError;
+    uint64_t    size     = boost::filesystem::file_size(it->path(), fileError);
+    std::time_t modified = boost::filesystem::last_write_time(it->path(), fileError);
+
+    if (fileError) {
+      continue;
+    }
+
+    std::string key = it->path().generic_string().substr(prefix.size());
+    mEntries[key]   = {size, static_cast<int64_t>(modified)};
+    mTotalSize += size;
+  }
+
+  if (error) {
+    logger().error("Failed to scan map cache '{}': '{}'!", mDirectory, error.message());
+  }
+
+  logger().info("Indexed {} files ({} MB) in map cache.", mEntries.size(),
+      mTotalSize / 1024 / 1024);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MapCache::writeLog() {
+  std::string logFile  = mDirectory + "/" + INDEX_FILE;
+  std::string tempFile = logFile + ".tmp";
+
+  mLog.close();
+
+  // Like the cached images, the log is replaced atomically.
+  std::ofstream out(tempFile, std::ofstream::out | std::ofstream::binary);
+  for (auto const& [key, entry] : mEntries) {
+    out << INSERT_RECORD << ' ' << entry.mSize << ' ' << entry.mLastAccess << ' ' << key << '\n';
+  }
+  out.close();
+
+  boost::system::error_code error;
+  if (out) {
+    boost::filesystem::rename(tempFile, logFile, error);
+  }
+
+  if (!out || error) {
+    logger().error("Failed to write index of map cache '{}'!", mDirectory);
+  } else {
+    mRecords = mEntries.size();
+  }
+
+  mLog.open(logFile, std::ofstream::app | std::ofstream::binary);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MapCache::needsMaintenance() const {
+  uint64_t quota = mQuota;
+  return (quota > 0 && mTotalSize > quota) ||
+         mRecords > 2 * mEntries.size() + MIN_OUTDATED_RECORDS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_MAP_CACHE_HPP
+#define CSP_WMS_MAP_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace csp::simplewmsbodies {
+
+/// The MapCache keeps track of the files in a map cache directory, so that the size of the cache
+/// can be limited. For each file, its size and the time of the last access are stored in an index.
+/// The index is kept in memory and persisted as an append-only log in the cache directory, so
+/// opening a cache only reads this log instead of walking the directory tree. Only caches which
+/// were created before the index existed are scanned once.
+///
+/// If the files in the cache exceed the quota, maintain() deletes the least recently used ones.
+/// It also rewrites the log once it contains many outdated records. All methods are thread-safe;
+/// maintain() is meant to be run in the background.
+class MapCache {
+ public:
+  /// The name of the index file in the cache directory.
+  static const std::string INDEX_FILE;
+
+  /// Reads the index of the given cache directory or creates it.
+  explicit MapCache(std::string directory);
+
+  MapCache(MapCache const& other) = delete;
+  MapCache(MapCache&& other)      = delete;
+
+  MapCache& operator=(MapCache const& other) = delete;
+  MapCache& operator=(MapCache&& other) = delete;
+
+  ~MapCache();
+
+  /// Sets the maximum size of all files in the cache in bytes. Zero means unlimited.
+  void setQuota(uint64_t bytes);
+
+  /// Returns true if the given file is in the cache and marks it as recently used. The file name
+  /// has to start with the cache directory, as returned by WebMapTextureLoader::getCacheFile().
+  bool touch(std::string const& fileName);
+
+  /// Adds a file which has been written to the cache or updates its size.
+  void insert(std::string const& fileName, uint64_t size);
+
+  /// Removes a file from the index, for example because it cannot be read anymore. The file itself
+  /// is not deleted.
+  void remove(std::string const& fileName);
+
+  /// Returns true if the cache exceeds its quota or the log should be compacted. Only one caller
+  /// gets true until maintain() has finished, so that maintenance is not scheduled twice.
+  bool requestMaintenance();
+
+  /// Deletes the least recently used files until the cache is well below its quota and compacts
+  /// the log if necessary.
+  void maintain();
+
+ private:
+  struct Entry {
+    uint64_t mSize       = 0;
+    int64_t  mLastAccess = 0; ///< Seconds since the epoch.
+  };
+
+  /// Returns the name of the given file relative to the cache directory.
+  std::string getKey(std::string const& fileName) const;
+
+  /// Replays the log. Returns false if there is none. complete is set to false if the last record
+  /// has been cut off.
+  bool readLog(bool& complete);
+
+  /// Adds all files in the cache directory to the index. Their modification time is used as last
+  /// access time.
+  void scanDirectory();
+
+  /// Replaces the log with one record per entry. mMutex has to be locked.
+  void writeLog();
+
+  bool needsMaintenance() const;
+
+  std::string                            mDirectory;
+  std::unordered_map<std::string, Entry> mEntries;
+  uint64_t                               mTotalSize = 0;
+  size_t                                 mRecords   = 0; ///< The number of records in the log.
+  std::ofstream                          mLog;
+  mutable std::mutex                     mMutex;
+
+  std::atomic<uint64_t> mQuota{0};
+  std::atomic<bool>     mMaintaining{false};
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_MAP_CACHE_HPP
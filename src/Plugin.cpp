@@ -13,8 +13,12 @@
 #include "../../../src/cs-core/TimeControl.hpp"
 #include "../../../src/cs-utils/logger.hpp"
 #include "SimpleWMSBody.hpp"
+#include "TextureRegistry.hpp"
 #include "logger.hpp"
 
+#include <algorithm>
+#include <chrono>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 EXPORT_FN cs::core::PluginBase* create() {
@@ -41,6 +45,8 @@ void from_json(nlohmann::json const& j, Plugin::Settings::WMSConfig& o) {
   cs::core::Settings::deserialize(j, "time", o.mTime);
   cs::core::Settings::deserialize(j, "preFetch", o.mPrefetchCount);
   cs::core::Settings::deserialize(j, "layers", o.mLayers);
+  cs::core::Settings::deserialize(j, "maxTileLevel", o.mMaxTileLevel);
+  cs::core::Settings::deserialize(j, "tileSize", o.mTileSize);
 }
 
 void to_json(nlohmann::json& j, Plugin::Settings::WMSConfig const& o) {
@@ -51,6 +57,8 @@ void to_json(nlohmann::json& j, Plugin::Settings::WMSConfig const& o) {
   cs::core::Settings::serialize(j, "time", o.mTime);
   cs::core::Settings::serialize(j, "preFetch", o.mPrefetchCount);
   cs::core::Settings::serialize(j, "layers", o.mLayers);
+  cs::core::Settings::serialize(j, "maxTileLevel", o.mMaxTileLevel);
+  cs::core::Settings::serialize(j, "tileSize", o.mTileSize);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -61,6 +69,7 @@ void from_json(nlohmann::json const& j, Plugin::Settings::SimpleWMSBody& o) {
   cs::core::Settings::deserialize(j, "texture", o.mTexture);
   cs::core::Settings::deserialize(j, "activeWms", o.mActiveWMS);
   cs::core::Settings::deserialize(j, "wms", o.mWMS);
+  cs::core::Settings::deserialize(j, "maxTextureCacheSize", o.mMaxTextureCacheSize);
 }
 
 void to_json(nlohmann::json& j, Plugin::Settings::SimpleWMSBody const& o) {
@@ -69,17 +78,36 @@ void to_json(nlohmann::json& j, Plugin::Settings::SimpleWMSBody const& o) {
   cs::core::Settings::serialize(j, "texture", o.mTexture);
   cs::core::Settings::serialize(j, "activeWms", o.mActiveWMS);
   cs::core::Settings::serialize(j, "wms", o.mWMS);
+  cs::core::Settings::serialize(j, "maxTextureCacheSize", o.mMaxTextureCacheSize);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void from_json(nlohmann::json const& j, Plugin::Settings& o) {
   cs::core::Settings::deserialize(j, "mapCache", o.mMapCache);
+  cs::core::Settings::deserialize(j, "validateMapCache", o.mValidateMapCache);
+  cs::core::Settings::deserialize(j, "rawTextureCache", o.mRawTextureCache);
+  cs::core::Settings::deserialize(j, "maxMapCacheSize", o.mMaxMapCacheSize);
+  cs::core::Settings::deserialize(j, "maxTextureCacheSize", o.mMaxTextureCacheSize);
+  cs::core::Settings::deserialize(j, "downloadThreads", o.mDownloadThreads);
+  cs::core::Settings::deserialize(j, "decodeThreads", o.mDecodeThreads);
+  cs::core::Settings::deserialize(j, "maxUploadPerFrame", o.mMaxUploadPerFrame);
+  cs::core::Settings::deserialize(j, "gpuTextureFrames", o.mGPUTextureFrames);
+  cs::core::Settings::deserialize(j, "mipmaps", o.mEnableMipmaps);
   cs::core::Settings::deserialize(j, "bodies", o.mBodies);
 }
 
 void to_json(nlohmann::json& j, Plugin::Settings const& o) {
   cs::core::Settings::serialize(j, "mapCache", o.mMapCache);
+  cs::core::Settings::serialize(j, "validateMapCache", o.mValidateMapCache);
+  cs::core::Settings::serialize(j, "rawTextureCache", o.mRawTextureCache);
+  cs::core::Settings::serialize(j, "maxMapCacheSize", o.mMaxMapCacheSize);
+  cs::core::Settings::serialize(j, "maxTextureCacheSize", o.mMaxTextureCacheSize);
+  cs::core::Settings::serialize(j, "downloadThreads", o.mDownloadThreads);
+  cs::core::Settings::serialize(j, "decodeThreads", o.mDecodeThreads);
+  cs::core::Settings::serialize(j, "maxUploadPerFrame", o.mMaxUploadPerFrame);
+  cs::core::Settings::serialize(j, "gpuTextureFrames", o.mGPUTextureFrames);
+  cs::core::Settings::serialize(j, "mipmaps", o.mEnableMipmaps);
   cs::core::Settings::serialize(j, "bodies", o.mBodies);
 }
 
@@ -196,38 +224,45 @@ void Plugin::onLoad() {
   // Read settings from JSON.
   from_json(mAllSettings->mPlugins.at("csp-simple-wms-bodies"), *mPluginSettings);
 
-  // First try to re-configure existing simpleWMSBodies. We assume that they are similar if they
-  // have the same name in the settings (which means they are attached to an anchor with the same
-  // name).
+  TextureCache::setGlobalBudget(
+      static_cast<size_t>(mPluginSettings->mMaxTextureCacheSize.get()) * 1024 * 1024);
+
+  // All bodies share one loader, so that the number of threads does not grow with the number of
+  // bodies.
+  if (!mTextureLoader) {
+    if (mPluginSettings->mValidateMapCache.get()) {
+      WebMapTextureLoader::validateCache(mPluginSettings->mMapCache.get());
+    }
+
+    mTextureLoader = std::make_shared<WebMapTextureLoader>(
+        mPluginSettings->mDownloadThreads.get(), mPluginSettings->mDecodeThreads.get());
+    mTextureRegistry = std::make_shared<TextureRegistry>(mTextureLoader);
+  }
+
+  mTextureLoader->setUseRawCache(mPluginSettings->mRawTextureCache.get());
+  mTextureLoader->setGenerateMipmaps(mPluginSettings->mEnableMipmaps.get());
+  mTextureLoader->setMapCacheQuota(
+      static_cast<uint64_t>(mPluginSettings->mMaxMapCacheSize.get()) * 1024 * 1024);
+
+  auto startTime = std::chrono::steady_clock::now();
+
+  // Delete the simpleWMSBodies which are not in the settings anymore. The others are re-configured
+  // below. We assume that they are similar if they have the same name in the settings (which
+  // means they are attached to an anchor with the same name).
   auto simpleWMSBody = mSimpleWMSBodies.begin();
   while (simpleWMSBody != mSimpleWMSBodies.end()) {
-    auto settings = mPluginSettings->mBodies.find(simpleWMSBody->first);
-    if (settings != mPluginSettings->mBodies.end()) {
-      // If there are settings for this simpleWMSBody, reconfigure it.
-      auto anchor                           = mAllSettings->mAnchors.find(settings->first);
-      auto [tStartExistence, tEndExistence] = anchor->second.getExistence();
-      simpleWMSBody->second->setStartExistence(tStartExistence);
-      simpleWMSBody->second->setEndExistence(tEndExistence);
-      simpleWMSBody->second->setFrameName(anchor->second.mFrame);
-      simpleWMSBody->second->setCenterName(anchor->second.mCenter);
-      simpleWMSBody->second->configure(settings->second);
-
-      setWMSSource(simpleWMSBody->second, settings->second.mActiveWMS);
-
-      // Add bookmarks to timeline from the intervals of the active WMS.
-      addBookmarks(simpleWMSBody->second->getTimeIntervals(), settings->second.mActiveWMS,
-          simpleWMSBody->second->getCenterName(), simpleWMSBody->second->getFrameName());
-
+    if (mPluginSettings->mBodies.find(simpleWMSBody->first) != mPluginSettings->mBodies.end()) {
       ++simpleWMSBody;
     } else {
-      // Else delete it.
       mSolarSystem->unregisterBody(simpleWMSBody->second);
       mInputManager->unregisterSelectable(simpleWMSBody->second);
       simpleWMSBody = mSimpleWMSBodies.erase(simpleWMSBody);
     }
   }
 
-  // Then add new simpleWMSBodies.
+  // Then create the new simpleWMSBodies. They are configured together with the existing ones.
+  std::vector<std::shared_ptr<SimpleWMSBody>> newBodies;
+
   for (auto const& settings : mPluginSettings->mBodies) {
     if (mSimpleWMSBodies.find(settings.first) != mSimpleWMSBodies.end()) {
       continue;
@@ -242,24 +277,62 @@ void Plugin::onLoad() {
 
     auto [tStartExistence, tEndExistence] = anchor->second.getExistence();
 
-    auto simpleWMSBody =
-        std::make_shared<SimpleWMSBody>(mAllSettings, mSolarSystem, mPluginSettings, mTimeControl,
-            anchor->second.mCenter, anchor->second.mFrame, tStartExistence, tEndExistence);
+    auto body = std::make_shared<SimpleWMSBody>(mAllSettings, mSolarSystem, mPluginSettings,
+        mTextureLoader, mTextureRegistry, mTimeControl, anchor->second.mCenter,
+        anchor->second.mFrame, tStartExistence, tEndExistence);
 
-    mSimpleWMSBodies.emplace(settings.first, simpleWMSBody);
+    mSimpleWMSBodies.emplace(settings.first, body);
+    newBodies.push_back(body);
+  }
+
+  // The startup is split into two phases. First, the background textures and the WMS images of
+  // all bodies are requested, so that the decode threads work on all of them in parallel.
+  for (auto const& [name, body] : mSimpleWMSBodies) {
+    auto const& settings = mPluginSettings->mBodies.at(name);
+    body->prepare(settings);
+    setWMSSource(body, settings.mActiveWMS);
+  }
 
-    setWMSSource(simpleWMSBody, settings.second.mActiveWMS);
-    simpleWMSBody->configure(settings.second);
-    simpleWMSBody->setSun(mSolarSystem->getSun());
+  // Then the bodies are configured one after another. This mostly waits for their background
+  // textures and uploads them.
+  for (auto const& [name, body] : mSimpleWMSBodies) {
+    auto bodyStartTime = std::chrono::steady_clock::now();
+
+    auto const& settings                  = mPluginSettings->mBodies.at(name);
+    auto        anchor                    = mAllSettings->mAnchors.find(name);
+    auto [tStartExistence, tEndExistence] = anchor->second.getExistence();
+    body->setStartExistence(tStartExistence);
+    body->setEndExistence(tEndExistence);
+    body->setFrameName(anchor->second.mFrame);
+    body->setCenterName(anchor->second.mCenter);
+    body->configure(settings);
 
     // Add bookmarks to timeline from the intervals of the active WMS.
-    addBookmarks(simpleWMSBody->getTimeIntervals(), settings.second.mActiveWMS,
-        simpleWMSBody->getCenterName(), simpleWMSBody->getFrameName());
+    addBookmarks(body->getTimeIntervals(), settings.mActiveWMS, body->getCenterName(),
+        body->getFrameName());
 
-    mSolarSystem->registerBody(simpleWMSBody);
-    mInputManager->registerSelectable(simpleWMSBody);
+    if (std::find(newBodies.begin(), newBodies.end(), body) != newBodies.end()) {
+      body->setSun(mSolarSystem->getSun());
+      mSolarSystem->registerBody(body);
+      mInputManager->registerSelectable(body);
+    }
+
+    auto const& timings = body->getStartupTimings();
+    logger().info("Configured '{}' in {:.1f} ms ({:.1f} ms waiting for the background texture, "
+                  "{:.1f} ms uploading it).",
+        name,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bodyStartTime)
+            .count(),
+        timings.mWaitTime, timings.mUploadTime);
   }
 
+  // Background textures of deleted bodies or of previous settings are not needed anymore.
+  mTextureRegistry->collect();
+
+  logger().info("Loaded {} bodies in {:.1f} ms.", mSimpleWMSBodies.size(),
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime)
+          .count());
+
   mSolarSystem->pActiveBody.touch(mActiveBodyConnection);
 }
 
@@ -18,6 +18,8 @@
 namespace csp::simplewmsbodies {
 
 class SimpleWMSBody;
+class TextureRegistry;
+class WebMapTextureLoader;
 
 /// This plugin provides the rendering of planets as spheres with a texture and an additional WMS
 /// based texture. Despite its name it can also render moons :P. It can be configured via the
@@ -36,6 +38,42 @@ class Plugin : public cs::core::PluginBase {
     /// Path to the map cache folder, can be absolute or relative to the cosmoscout executable.
     cs::utils::DefaultProperty<std::string> mMapCache{"texture-cache"};
 
+    /// If enabled, the map cache is checked for corrupt files when the plugin is loaded. This has
+    /// to read the end of every file in the cache, so it may take a while for large caches.
+    cs::utils::DefaultProperty<bool> mValidateMapCache{false};
+
+    /// If enabled, decoded textures are additionally stored as uncompressed RGBA files in the map
+    /// cache. This makes loading cached textures a lot faster but requires more disk space.
+    cs::utils::DefaultProperty<bool> mRawTextureCache{false};
+
+    /// The maximum size of all files in the map cache in MB. If the cache grows larger, the least
+    /// recently used files are deleted. Zero means unlimited.
+    cs::utils::DefaultProperty<uint32_t> mMaxMapCacheSize{0};
+
+    /// The maximum amount of memory in MB used for decoded WMS textures by all bodies combined.
+    /// Zero means unlimited.
+    cs::utils::DefaultProperty<uint32_t> mMaxTextureCacheSize{4096};
+
+    /// The number of threads used for downloading WMS images. This is shared by all bodies and is
+    /// only read when the plugin is loaded.
+    cs::utils::DefaultProperty<uint32_t> mDownloadThreads{8};
+
+    /// The number of threads used for decoding WMS images. This is shared by all bodies and is
+    /// only read when the plugin is loaded.
+    cs::utils::DefaultProperty<uint32_t> mDecodeThreads{2};
+
+    /// The maximum amount of texture data in MB which is transferred to the GPU per frame and
+    /// body. Larger textures are uploaded over several frames.
+    cs::utils::DefaultProperty<uint32_t> mMaxUploadPerFrame{32};
+
+    /// The number of uploaded timesteps each body keeps on the GPU. At least two are required for
+    /// interpolation, a third one allows uploading the next timestep ahead of time.
+    cs::utils::DefaultProperty<uint32_t> mGPUTextureFrames{4};
+
+    /// If enabled, mipmaps are generated for all WMS textures on the decode threads. This needs a
+    /// third more memory but avoids aliasing when a body is small on screen.
+    cs::utils::DefaultProperty<bool> mEnableMipmaps{true};
+
     /// A single WMS data set.
     struct WMSConfig {
       std::string mCopyright; ///< The copyright holder of the data set (also shown in the UI).
@@ -46,6 +84,8 @@ class Plugin : public cs::core::PluginBase {
       std::string                mLayers; ///< A comma,seperated list of WMS layers.
       std::optional<int>
           mPrefetchCount; ///< The amount of textures that gets pre-fetched in every time direction.
+      std::optional<int> mMaxTileLevel; ///< If set, the data set is streamed as quadtree tiles.
+      std::optional<int> mTileSize;     ///< The width and height of a single tile in pixels.
     };
 
     /// The startup settings for a planet.
@@ -55,6 +95,8 @@ class Plugin : public cs::core::PluginBase {
       std::string        mTexture;           ///< The path to surface texture.
       std::string        mActiveWMS;         ///< The name of the currently active WMS data set.
       std::map<std::string, WMSConfig> mWMS; ///< The data sets containing WMS data.
+      std::optional<uint32_t>
+          mMaxTextureCacheSize; ///< The maximum memory in MB used for decoded WMS textures.
     };
 
     std::map<std::string, SimpleWMSBody> mBodies; ///< A list of bodies with their anchor names.
@@ -76,7 +118,9 @@ class Plugin : public cs::core::PluginBase {
   /// Remove the current bookmarks.
   void removeBookmarks();
 
-  std::shared_ptr<Settings> mPluginSettings = std::make_shared<Settings>();
+  std::shared_ptr<Settings>            mPluginSettings = std::make_shared<Settings>();
+  std::shared_ptr<WebMapTextureLoader> mTextureLoader;
+  std::shared_ptr<TextureRegistry>     mTextureRegistry;
   std::map<std::string, std::shared_ptr<SimpleWMSBody>> mSimpleWMSBodies;
   std::vector<int>                                      mBookmarkIDs;
 
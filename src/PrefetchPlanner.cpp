@@ -0,0 +1,103 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PrefetchPlanner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PrefetchPlanner::setPrefetchCount(int count) {
+  mPrefetchCount = std::max(count, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PrefetchPlanner::addLatencySample(double seconds) {
+  const double alpha = 0.2;
+
+  if (mHasLatency) {
+    mLatency = alpha * seconds + (1.0 - alpha) * mLatency;
+  } else {
+    mLatency    = seconds;
+    mHasLatency = true;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PrefetchPlanner::resetLatency() {
+  mLatency    = 0.0;
+  mHasLatency = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double PrefetchPlanner::getLatency() const {
+  return mLatency;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PrefetchPlanner::plan(
+    int64_t currentStep, double stepsPerSecond, std::vector<int>& offsets) const {
+  offsets.clear();
+  offsets.push_back(0);
+
+  auto add = [&offsets](int64_t offset) {
+    if (std::find(offsets.begin(), offsets.end(), offset) == offsets.end()) {
+      offsets.push_back(static_cast<int>(offset));
+    }
+  };
+
+  // The amount of timesteps which pass while a single texture is loaded.
+  double stepsPerRequest = std::abs(stepsPerSecond) * mLatency;
+
+  // When the time stands still or moves slowly, the textures on both sides of the current one are
+  // equally likely to be needed next.
+  if (stepsPerRequest < 1.0) {
+    for (int i = 1; i <= mPrefetchCount; ++i) {
+      add(i);
+      add(-i);
+    }
+    return;
+  }
+
+  if (mPrefetchCount == 0) {
+    return;
+  }
+
+  int64_t direction = stepsPerSecond > 0.0 ? 1 : -1;
+
+  // The interpolation partner is always the following timestep.
+  add(1);
+
+  // Timesteps closer than the distance travelled during one request would arrive too late.
+  auto first = static_cast<int64_t>(std::ceil(stepsPerRequest));
+
+  // If the playback outruns the server, only every stride-th timestep is loaded. The selected
+  // timesteps are aligned to multiples of the stride, so that the selection does not change
+  // every frame while the time is running.
+  auto stride = std::max(static_cast<int64_t>(std::ceil(stepsPerRequest / mPrefetchCount)),
+      static_cast<int64_t>(1));
+
+  int64_t target = currentStep + direction * first;
+  int64_t rest   = ((target % stride) + stride) % stride;
+  if (rest != 0) {
+    target += direction > 0 ? stride - rest : -rest;
+  }
+
+  for (int i = 0; i < mPrefetchCount; ++i) {
+    add(target - currentStep + direction * stride * i);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
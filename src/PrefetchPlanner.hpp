@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_PREFETCH_PLANNER_HPP
+#define CSP_WMS_PREFETCH_PLANNER_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+/// The PrefetchPlanner decides which timesteps of a WMS data set should be loaded. When the
+/// simulation time stands still, it selects the configured amount of timesteps on both sides of
+/// the current one. When the time is running, it only looks ahead in the direction of motion and
+/// skips timesteps which would arrive too late. If playback is faster than the server can deliver
+/// textures, only every n-th timestep is selected.
+class PrefetchPlanner {
+ public:
+  /// The amount of textures which are pre-fetched in addition to the current one. Zero disables
+  /// pre-fetching entirely.
+  void setPrefetchCount(int count);
+
+  /// Feeds the time in seconds which passed between issuing a request and receiving the decoded
+  /// texture. The planner uses an exponential moving average of these samples.
+  void addLatencySample(double seconds);
+
+  /// Forgets all latency samples, for example when the data set changes.
+  void resetLatency();
+
+  /// Returns the current estimate of the time it takes to load a texture in seconds.
+  double getLatency() const;
+
+  /// Stores the offsets in timesteps relative to currentStep which should be loaded in the given
+  /// vector, sorted by urgency. The first element is always the current timestep. currentStep is
+  /// the index of the current timestep within its interval, stepsPerSecond is the signed playback
+  /// speed in timesteps per real-time second. The vector is cleared first; as it is usually reused
+  /// every frame, planning does not allocate memory.
+  void plan(int64_t currentStep, double stepsPerSecond, std::vector<int>& offsets) const;
+
+ private:
+  int    mPrefetchCount = 0;
+  double mLatency       = 0.0;
+  bool   mHasLatency    = false;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_PREFETCH_PLANNER_HPP
@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "PriorityThreadPool.hpp"
+
+#include <algorithm>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PriorityThreadPool::TaskHandle::TaskHandle(int priority)
+    : mPriority(priority) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PriorityThreadPool::TaskHandle::setPriority(int priority) {
+  mPriority = priority;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int PriorityThreadPool::TaskHandle::getPriority() const {
+  return mPriority;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PriorityThreadPool::TaskHandle::cancel() {
+  mCancelled = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool PriorityThreadPool::TaskHandle::isCancelled() const {
+  return mCancelled;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PriorityThreadPool::PriorityThreadPool(uint32_t threads) {
+  for (uint32_t i = 0; i < threads; ++i) {
+    mWorkers.emplace_back([this]() {
+      while (true) {
+        std::function<void()> task;
+
+        {
+          std::unique_lock<std::mutex> lock(mMutex);
+          mCondition.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+
+          if (mStop) {
+            return;
+          }
+
+          task = popTask();
+        }
+
+        if (task) {
+          task();
+        }
+      }
+    });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PriorityThreadPool::~PriorityThreadPool() {
+  shutdown();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PriorityThreadPool::shutdown() {
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+
+  mCondition.notify_all();
+
+  for (auto& worker : mWorkers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  // The tasks are destroyed outside of the lock, as this may release resources of their owners.
+  std::vector<Task> tasks;
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    tasks.swap(mTasks);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t PriorityThreadPool::getPendingTaskCount() const {
+  std::unique_lock<std::mutex> lock(mMutex);
+  return mTasks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::function<void()> PriorityThreadPool::popTask() {
+  mTasks.erase(std::remove_if(mTasks.begin(), mTasks.end(),
+                   [](Task const& task) { return task.mHandle->isCancelled(); }),
+      mTasks.end());
+
+  if (mTasks.empty()) {
+    return {};
+  }
+
+  auto best         = mTasks.begin();
+  int  bestPriority = best->mHandle->getPriority();
+
+  for (auto task = std::next(mTasks.begin()); task != mTasks.end(); ++task) {
+    int priority = task->mHandle->getPriority();
+    if (priority > bestPriority || (priority == bestPriority && task->mOrder < best->mOrder)) {
+      best         = task;
+      bestPriority = priority;
+    }
+  }
+
+  std::function<void()> function = std::move(best->mFunction);
+  mTasks.erase(best);
+
+  return function;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_PRIORITY_THREAD_POOL_HPP
+#define CSP_WMS_PRIORITY_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+/// A thread pool similar to cs::utils::ThreadPool, but each task is enqueued together with a
+/// TaskHandle which carries its priority. Idle workers always pick the pending task with the
+/// highest priority. Tasks with the same priority are executed in the order in which they were
+/// enqueued. The priority of a task can be changed and the task can be cancelled after it has been
+/// enqueued.
+class PriorityThreadPool {
+ public:
+  /// Shared state between the owner of a task and the pool.
+  class TaskHandle {
+   public:
+    explicit TaskHandle(int priority);
+
+    /// Larger values are executed first. This has no effect once a worker picked up the task.
+    void setPriority(int priority);
+    int  getPriority() const;
+
+    /// Pending tasks which are cancelled are discarded without being executed, their futures will
+    /// report a broken promise. Running tasks may poll isCancelled() to abort early.
+    void cancel();
+    bool isCancelled() const;
+
+   private:
+    std::atomic<int>  mPriority;
+    std::atomic<bool> mCancelled{false};
+  };
+
+  /// Starts the given amount of worker threads.
+  explicit PriorityThreadPool(uint32_t threads);
+
+  PriorityThreadPool(PriorityThreadPool const& other) = delete;
+  PriorityThreadPool(PriorityThreadPool&& other)      = delete;
+
+  PriorityThreadPool& operator=(PriorityThreadPool const& other) = delete;
+  PriorityThreadPool& operator=(PriorityThreadPool&& other) = delete;
+
+  /// Calls shutdown().
+  ~PriorityThreadPool();
+
+  /// Waits for all running tasks to finish and stops the workers. Pending tasks are discarded,
+  /// their futures will report a broken promise. Tasks which are enqueued afterwards are discarded
+  /// as well. Calling this more than once has no effect.
+  void shutdown();
+
+  /// Adds a new task to the queue. The priority of the task is read from the given handle
+  /// whenever a worker looks for the next task to execute.
+  template <typename F>
+  auto enqueue(std::shared_ptr<TaskHandle> handle, F&& f) -> std::future<std::invoke_result_t<F>> {
+    using ReturnType = std::invoke_result_t<F>;
+
+    auto task   = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(f));
+    auto result = task->get_future();
+
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+
+      // The task is destroyed without being executed, which breaks the promise of the future.
+      if (mStop) {
+        return result;
+      }
+
+      mTasks.push_back(Task{std::move(handle), mTaskCounter++, [task]() { (*task)(); }});
+    }
+
+    mCondition.notify_one();
+    return result;
+  }
+
+  /// Returns the number of tasks which are not yet picked up by a worker.
+  size_t getPendingTaskCount() const;
+
+ private:
+  struct Task {
+    std::shared_ptr<TaskHandle> mHandle;
+    uint64_t                    mOrder;
+    std::function<void()>       mFunction;
+  };
+
+  /// Removes cancelled tasks and returns the pending task with the highest priority. As priorities
+  /// may change at any time, this has to search the entire queue. The queue must not be empty.
+  std::function<void()> popTask();
+
+  std::vector<std::thread> mWorkers;
+  std::vector<Task>        mTasks;
+  uint64_t                 mTaskCounter = 0;
+
+  mutable std::mutex      mMutex;
+  std::condition_variable mCondition;
+  bool                    mStop = false;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_PRIORITY_THREAD_POOL_HPP
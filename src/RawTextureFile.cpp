@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "RawTextureFile.hpp"
+
+#include "logger.hpp"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <cstring>
+#include <fstream>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+const char     MAGIC[4]    = {'W', 'M', 'S', 'T'};
+const uint32_t VERSION     = 1;
+const uint32_t DATA_OFFSET = 32;
+} // namespace
+
+static_assert(sizeof(RawTextureFile::Header) == DATA_OFFSET, "Unexpected header size!");
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::string RawTextureFile::EXTENSION = ".rgba";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RawTextureFile::Header RawTextureFile::createHeader(int width, int height) {
+  Header header{};
+  std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+  header.mVersion    = VERSION;
+  header.mWidth      = static_cast<uint32_t>(width);
+  header.mHeight     = static_cast<uint32_t>(height);
+  header.mDataOffset = DATA_OFFSET;
+  return header;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RawTextureFile::isValid(Header const& header, size_t fileSize) {
+  return std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) == 0 && header.mVersion == VERSION &&
+         header.mDataOffset == DATA_OFFSET &&
+         fileSize == DATA_OFFSET + static_cast<size_t>(header.mWidth) * header.mHeight * 4;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RawTextureFile::isValid(std::string const& fileName) {
+  std::ifstream file(fileName, std::ifstream::binary | std::ifstream::ate);
+  if (!file) {
+    return false;
+  }
+
+  auto   size = static_cast<size_t>(file.tellg());
+  Header header{};
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+  return file.good() && isValid(header, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RawTextureFile::getFileName(std::string const& imageFile) {
+  return imageFile.substr(0, imageFile.find_last_of('.')) + EXTENSION;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DecodedTexture RawTextureFile::read(std::string const& fileName) {
+  std::shared_ptr<boost::interprocess::mapped_region> region;
+
+  try {
+    boost::interprocess::file_mapping mapping(fileName.c_str(), boost::interprocess::read_only);
+    region = std::make_shared<boost::interprocess::mapped_region>(
+        mapping, boost::interprocess::read_only);
+  } catch (std::exception const& e) {
+    logger().warn("Failed to map raw texture file '{}': {}", fileName, e.what());
+    return DecodedTexture();
+  }
+
+  if (region->get_size() < sizeof(Header)) {
+    logger().warn("Ignoring invalid raw texture file '{}'.", fileName);
+    return DecodedTexture();
+  }
+
+  Header header{};
+  std::memcpy(&header, region->get_address(), sizeof(Header));
+
+  if (!isValid(header, region->get_size())) {
+    logger().warn("Ignoring invalid raw texture file '{}'.", fileName);
+    return DecodedTexture();
+  }
+
+  // Ask the operating system to read the file in the background. Else the pages would be read
+  // when the texture is uploaded on the render thread.
+  region->advise(boost::interprocess::mapped_region::advice_willneed);
+
+  // The texture data points into the mapped region and keeps it alive. No copy is made, and the
+  // operating system may drop the pages under memory pressure as they are backed by the file.
+  DecodedTexture texture;
+  texture.mWidth  = static_cast<int>(header.mWidth);
+  texture.mHeight = static_cast<int>(header.mHeight);
+  texture.mData   = std::shared_ptr<unsigned char>(
+      region, static_cast<unsigned char*>(region->get_address()) + header.mDataOffset);
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
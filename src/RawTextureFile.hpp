@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_RAW_TEXTURE_FILE_HPP
+#define CSP_WMS_RAW_TEXTURE_FILE_HPP
+
+#include "WebMapTextureLoader.hpp"
+
+#include <cstdint>
+#include <string>
+
+namespace csp::simplewmsbodies {
+
+/// Decoded textures can be stored in the map cache next to the images from the map server. These
+/// files consist of a small header followed by the uncompressed RGBA pixels, so loading them
+/// requires no decoding at all. The pixel data starts at a fixed offset, which allows mapping the
+/// file to memory. All values are stored in native byte order, as the files never leave the
+/// machine which created them.
+class RawTextureFile {
+ public:
+  /// The file extension of raw texture files.
+  static const std::string EXTENSION;
+
+  /// The header at the beginning of each raw texture file.
+  struct Header {
+    char     mMagic[4];   ///< Always "WMST".
+    uint32_t mVersion;    ///< Incremented whenever the format changes.
+    uint32_t mWidth;      ///< The width of the texture in pixels.
+    uint32_t mHeight;     ///< The height of the texture in pixels.
+    uint32_t mDataOffset; ///< The offset of the pixel data from the beginning of the file.
+    uint32_t mReserved[3];
+  };
+
+  /// Returns a header for a texture of the given size.
+  static Header createHeader(int width, int height);
+
+  /// Returns true if the header was written by this version and the file has the expected size.
+  static bool isValid(Header const& header, size_t fileSize);
+
+  /// Returns true if the given file is a complete raw texture file.
+  static bool isValid(std::string const& fileName);
+
+  /// Returns the name of the raw texture file which belongs to the given cached image.
+  static std::string getFileName(std::string const& imageFile);
+
+  /// Maps the given file to memory. The pixel data of the returned texture points directly into
+  /// the mapped file, the mapping is released together with the last copy of the texture. A
+  /// texture without data is returned if the file is not valid.
+  static DecodedTexture read(std::string const& fileName);
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_RAW_TEXTURE_FILE_HPP
@@ -9,10 +9,10 @@
 #include "../../../src/cs-core/Settings.hpp"
 #include "../../../src/cs-core/SolarSystem.hpp"
 #include "../../../src/cs-core/TimeControl.hpp"
-#include "../../../src/cs-graphics/TextureLoader.hpp"
 #include "../../../src/cs-utils/FrameTimings.hpp"
 #include "../../../src/cs-utils/filesystem.hpp"
 #include "../../../src/cs-utils/utils.hpp"
+#include "logger.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
 #include <VistaKernel/GraphicsManager/VistaTransformNode.h>
@@ -26,16 +26,73 @@
 #include <curlpp/Options.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
+#include <chrono>
+
 namespace csp::simplewmsbodies {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-const std::string SimpleWMSBody::SPHERE_VERT = R"(
-uniform vec3 uSunDirection;
-uniform vec3 uRadii;
-uniform mat4 uMatModelView;
-uniform mat4 uMatProjection;
+const int      SimpleWMSBody::MIN_REQUEST_SIZE    = 64;
+const uint32_t SimpleWMSBody::GEOMETRY_LODS       = 4;
+const uint32_t SimpleWMSBody::MIN_GRID_RESOLUTION = 16;
+const double   SimpleWMSBody::MAX_EDGE_LENGTH     = 8.0;
+const GLuint   SimpleWMSBody::FRAME_DATA_BINDING  = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// The contents of the FrameData uniform block. The layout has to match the std140 rules.
+struct FrameData {
+  float   mMatModelView[16];
+  float   mMatProjection[16];
+  float   mSunDirection[3];
+  float   mSunIlluminance;
+  float   mRadii[3];
+  float   mAmbientBrightness;
+  float   mFarClip;
+  float   mFade;
+  int32_t mUseTexture;
+  int32_t mUseSecondTexture;
+  int32_t mUseTiles;
+  float   mTileAtlasSlots;
+  float   mTileSize;
+  float   mPadding;
+};
+
+static_assert(sizeof(FrameData) == 192, "FrameData does not match the std140 layout!");
+
+// The key of the texture of a data set without time.
+const Timestep STATIC_TEXTURE{0, 0};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// All uniforms which change per frame are stored in a uniform buffer, which is updated with a
+// single write. The block is shared by both shader stages.
+const std::string SimpleWMSBody::FRAME_DATA = R"(
+layout(std140) uniform FrameData {
+  mat4  uMatModelView;
+  mat4  uMatProjection;
+  vec3  uSunDirection;
+  float uSunIlluminance;
+  vec3  uRadii;
+  float uAmbientBrightness;
+  float uFarClip;
+  float uFade;
+  bool  uUseTexture;
+  bool  uUseSecondTexture;
+  bool  uUseTiles;
+  float uTileAtlasSlots;
+  float uTileSize;
+};
+)";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::string SimpleWMSBody::SPHERE_VERT = R"(
 // inputs
 layout(location = 0) in vec2 iGridPos;
 
@@ -73,16 +130,11 @@ void main()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 const std::string SimpleWMSBody::SPHERE_FRAG = R"(
-uniform vec3 uSunDirection;
 uniform sampler2D uBackgroundTexture;
 uniform sampler2D uWMSTexture;
 uniform sampler2D uSecondWMSTexture;
-uniform float uAmbientBrightness;
-uniform float uSunIlluminance;
-uniform float uFarClip;
-uniform float uFade;
-uniform bool uUseTexture;
-uniform bool uUseSecondTexture;
+uniform sampler2D uTileAtlas;
+uniform usampler2D uTileIndex;
 
 // inputs
 in vec2 vTexCoords;
@@ -100,12 +152,34 @@ vec3 SRGBtoLINEAR(vec3 srgbIn)
   return mix(srgbIn / vec3(12.92), pow((srgbIn + vec3(0.055)) / vec3(1.055), vec3(2.4)), bLess);
 }
 
+// Looks up the best available tile for the given texture coordinates in the index and samples it
+// from the atlas.
+vec4 sampleTiles(vec2 texCoords)
+{
+  ivec2 indexSize = textureSize(uTileIndex, 0);
+  uvec4 entry     = texelFetch(uTileIndex, min(ivec2(texCoords * indexSize), indexSize - 1), 0);
+
+  if (entry.a == 0u) {
+    return vec4(0.0);
+  }
+
+  // Stay half a texel away from the tile border to avoid bleeding from neighbouring slots.
+  vec2 tiles = vec2(float(2u << entry.z), float(1u << entry.z));
+  vec2 local = fract(texCoords * tiles);
+  local      = clamp(local, vec2(0.5 / uTileSize), vec2(1.0 - 0.5 / uTileSize));
+
+  return texture(uTileAtlas, (vec2(entry.xy) + local) / uTileAtlasSlots);
+}
+
 void main()
 {
     vec3 backColor = texture(uBackgroundTexture, vTexCoords).rgb;
     oColor = backColor;
 
-    if (uUseTexture) {
+    if (uUseTiles) {
+      vec4 tileColor = sampleTiles(vTexCoords);
+      oColor = mix(oColor, tileColor.rgb, tileColor.a);
+    } else if (uUseTexture) {
       // WMS texture
       vec4 texColor = texture(uWMSTexture, vTexCoords);
       oColor = mix(oColor, texColor.rgb, texColor.a); 
@@ -139,57 +213,27 @@ void main()
 SimpleWMSBody::SimpleWMSBody(std::shared_ptr<cs::core::Settings> const& settings,
     std::shared_ptr<cs::core::SolarSystem>                              solarSystem,
     std::shared_ptr<Plugin::Settings> const&                            pluginSettings,
+    std::shared_ptr<WebMapTextureLoader>                                textureLoader,
+    std::shared_ptr<TextureRegistry>                                    textureRegistry,
     std::shared_ptr<cs::core::TimeControl> timeControl, std::string const& sCenterName,
     std::string const& sFrameName, double tStartExistence, double tEndExistence)
     : cs::scene::CelestialBody(sCenterName, sFrameName, tStartExistence, tEndExistence)
     , mSettings(settings)
     , mSolarSystem(solarSystem)
     , mPluginSettings(pluginSettings)
+    , mTextureLoader(std::move(textureLoader))
+    , mTextureRegistry(std::move(textureRegistry))
     , mRadii(cs::core::SolarSystem::getRadii(sCenterName))
-    , mWMSTexture(new VistaTexture(GL_TEXTURE_2D))
-    , mSecondWMSTexture(new VistaTexture(GL_TEXTURE_2D)) {
+    , mTimerName("Simple WMS Bodies " + sCenterName)
+    , mUploader(mTextureLoader)
+    , mGPUTextures(pluginSettings->mGPUTextureFrames.get()) {
   pVisibleRadius = mRadii[0];
   mTimeControl   = timeControl;
 
-  // For rendering the sphere, we create a 2D-grid which is warped into a sphere in the vertex
-  // shader. The vertex positions are directly used as texture coordinates.
-  std::vector<float>    vertices(mGridResolutionX * mGridResolutionY * 2);
-  std::vector<unsigned> indices((mGridResolutionX - 1) * (2 + 2 * mGridResolutionY));
-
-  for (uint32_t x = 0; x < mGridResolutionX; ++x) {
-    for (uint32_t y = 0; y < mGridResolutionY; ++y) {
-      vertices[(x * mGridResolutionY + y) * 2 + 0] = 1.f / (mGridResolutionX - 1) * x;
-      vertices[(x * mGridResolutionY + y) * 2 + 1] = 1.f / (mGridResolutionY - 1) * y;
-    }
-  }
-
-  uint32_t index = 0;
-
-  for (uint32_t x = 0; x < mGridResolutionX - 1; ++x) {
-    indices[index++] = x * mGridResolutionY;
-    for (uint32_t y = 0; y < mGridResolutionY; ++y) {
-      indices[index++] = x * mGridResolutionY + y;
-      indices[index++] = (x + 1) * mGridResolutionY + y;
-    }
-    indices[index] = indices[index - 1];
-    ++index;
-  }
-
-  mSphereVAO.Bind();
-
-  mSphereVBO.Bind(GL_ARRAY_BUFFER);
-  mSphereVBO.BufferData(vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-
-  mSphereIBO.Bind(GL_ELEMENT_ARRAY_BUFFER);
-  mSphereIBO.BufferData(indices.size() * sizeof(unsigned), indices.data(), GL_STATIC_DRAW);
-
-  mSphereVAO.EnableAttributeArray(0);
-  mSphereVAO.SpecifyAttributeArrayFloat(
-      0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0, &mSphereVBO);
-
-  mSphereVAO.Release();
-  mSphereIBO.Release();
-  mSphereVBO.Release();
+  glGenBuffers(1, &mFrameDataBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, mFrameDataBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
   // Recreate the shader if lighting or HDR rendering mode are toggled.
   mEnableLightingConnection = mSettings->mGraphics.pEnableLighting.connect(
@@ -206,27 +250,66 @@ SimpleWMSBody::SimpleWMSBody(std::shared_ptr<cs::core::Settings> const& settings
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 SimpleWMSBody::~SimpleWMSBody() {
+  // The texture loader is shared with other bodies, so we have to cancel our requests explicitly.
+  for (auto const& request : mRequests) {
+    request.mHandle->cancel();
+  }
+
   mSettings->mGraphics.pEnableLighting.disconnect(mEnableLightingConnection);
   mSettings->mGraphics.pEnableHDR.disconnect(mEnableHDRConnection);
 
+  glDeleteBuffers(1, &mFrameDataBuffer);
+
   VistaSceneGraph* pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
   pSG->GetRoot()->DisconnectChild(mGLNode.get());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void SimpleWMSBody::prepare(Plugin::Settings::SimpleWMSBody const& settings) {
+  mTextureRegistry->prepare(settings.mTexture);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void SimpleWMSBody::configure(Plugin::Settings::SimpleWMSBody const& settings) {
-  if (mSimpleWMSBodySettings.mTexture != settings.mTexture) {
-    mBackgroundTexture = cs::graphics::TextureLoader::loadFromFile(settings.mTexture);
+  // The registry returns the resident texture right away, unless the file has been modified.
+  auto startTime = std::chrono::steady_clock::now();
+  mTextureRegistry->wait(settings.mTexture);
+  auto decodedTime = std::chrono::steady_clock::now();
+
+  mBackgroundTexture = mTextureRegistry->get(settings.mTexture);
+
+  mStartupTimings.mWaitTime =
+      std::chrono::duration<double, std::milli>(decodedTime - startTime).count();
+  mStartupTimings.mUploadTime =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodedTime)
+          .count();
+
+  uint32_t gridResolutionX = settings.mGridResolutionX.value_or(200);
+  uint32_t gridResolutionY = settings.mGridResolutionY.value_or(100);
+
+  // The sphere geometry is rebuilt in the next frame.
+  if (gridResolutionX != mGridResolutionX || gridResolutionY != mGridResolutionY) {
+    mGridResolutionX = gridResolutionX;
+    mGridResolutionY = gridResolutionY;
+    mGeometryDirty   = true;
   }
-  mGridResolutionX = settings.mGridResolutionX.value_or(200);
-  mGridResolutionY = settings.mGridResolutionY.value_or(100);
+
+  mTextures.setBudget(
+      static_cast<size_t>(settings.mMaxTextureCacheSize.value_or(0)) * 1024 * 1024);
 
   mSimpleWMSBodySettings = settings;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+SimpleWMSBody::StartupTimings const& SimpleWMSBody::getStartupTimings() const {
+  return mStartupTimings;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void SimpleWMSBody::setSun(std::shared_ptr<const cs::scene::CelestialObject> const& sun) {
   mSun = sun;
 }
@@ -282,138 +365,211 @@ bool SimpleWMSBody::Do() {
     return true;
   }
 
-  cs::utils::FrameTimings::ScopedTimer timer("Simple WMS Bodies");
+  cs::utils::FrameTimings::ScopedTimer timer(mTimerName);
 
-  if (mActiveWMS.mTime.has_value()) {
-    boost::posix_time::ptime time =
-        cs::utils::convert::time::toPosix(mTimeControl->pSimulationTime.get());
+  // The size of the body on screen determines the level of detail of the geometry and how many
+  // mip levels have to be uploaded.
+  glm::dvec3 observer;
+  double     pixelScale;
+  getViewParameters(observer, pixelScale);
+  double distance = std::max(glm::length(observer) - mRadii[0], 0.001 * mRadii[0]);
+  mScreenSize     = 2.0 * mRadii[0] / distance * pixelScale;
 
-    // Select WMS textures to be downloaded. If no pre-fetch is set, only sellect the texture for
-    // the current timestep.
-    for (int preFetch = -mActiveWMS.mPrefetchCount.value_or(0);
-         preFetch <= mActiveWMS.mPrefetchCount.value_or(0); preFetch++) {
-      boost::posix_time::time_duration td = boost::posix_time::seconds(mIntervalDuration);
-      time = cs::utils::convert::time::toPosix(mTimeControl->pSimulationTime.get()) + td * preFetch;
-      boost::posix_time::time_duration timeSinceStart;
-      boost::posix_time::ptime         startTime =
-          time - boost::posix_time::microseconds(time.time_of_day().fractional_seconds());
-      bool inInterval = utils::timeInIntervals(
-          startTime, mTimeIntervals, timeSinceStart, mIntervalDuration, mFormat);
-
-      if (mIntervalDuration != 0) {
-        startTime -= boost::posix_time::seconds(timeSinceStart.total_seconds() % mIntervalDuration);
-      }
-      std::string timeString = utils::timeToString(mFormat.c_str(), startTime);
-
-      // Select a WMS texture over the period of timeDuration if timespan is enabled.
-      if (mPluginSettings->mEnableTimespan.get() && mIntervalDuration != 0) {
-        boost::posix_time::time_duration timeDuration =
-            boost::posix_time::seconds(mIntervalDuration);
-        boost::posix_time::ptime intervalAfter = getStartTime(startTime + timeDuration);
-        timeString += "/" + utils::timeToString(mFormat.c_str(), intervalAfter);
-      }
+  // With timespans enabled, different textures are requested for the same timesteps.
+  if (mActiveWMS.mTime.has_value() && mTimespan != mPluginSettings->mEnableTimespan.get()) {
+    clearTimesteps();
+    mTimespan = mPluginSettings->mEnableTimespan.get();
+  }
 
-      auto texture1 = mTextureFilesBuffer.find(timeString);
-      auto texture2 = mTexturesBuffer.find(timeString);
-      auto texture3 = mTextures.find(timeString);
-
-      // Only load textures those aren't stored yet.
-      if (texture1 == mTextureFilesBuffer.end() && texture2 == mTexturesBuffer.end() &&
-          texture3 == mTextures.end() && inInterval) {
-        // Load WMS texture to the disk.
-        mTextureFilesBuffer.insert(std::pair<std::string, std::future<std::string>>(
-            timeString, mTextureLoader.loadTextureAsync(timeString, mRequest, mActiveWMS.mLayers,
-                            mPluginSettings->mMapCache.get())));
-      }
+  if (mTiles) {
+    updateTiles();
+  } else if (mActiveWMS.mTime.has_value()) {
+    // Smaller images are requested from the server while the body is small on screen. More
+    // detail is requested as soon as it is needed, less only once the body shrank considerably.
+    // Very small images are not worth a request of their own.
+    int requiredLevel = getRequiredResolutionLevel();
+    while (requiredLevel > 0 && (mActiveWMS.mWidth >> requiredLevel) < MIN_REQUEST_SIZE) {
+      --requiredLevel;
     }
 
-    bool fileError = false;
+    if (requiredLevel < mResolutionLevel || requiredLevel > mResolutionLevel + 2) {
+      setResolutionLevel(requiredLevel);
+    }
 
-    // Check whether the WMS textures are loaded to the disk.
-    auto fileIt = mTextureFilesBuffer.begin();
-    while (fileIt != mTextureFilesBuffer.end()) {
-      if (fileIt->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-        std::string fileName = fileIt->second.get();
+    boost::posix_time::ptime time =
+        cs::utils::convert::time::toPosix(mTimeControl->pSimulationTime.get());
+    auto current = mTimeIndex.find(time);
+
+    // In a gap between two intervals, the pre-fetch window starts at the timestep which will be
+    // reached next in the direction of playback.
+    auto anchor = current;
+    if (!anchor) {
+      anchor = mTimeControl->pTimeSpeed.get() >= 0.f ? mTimeIndex.getNext(time)
+                                                      : mTimeIndex.getPrevious(time);
+    }
 
-        if (fileName != "Error") {
-          // Load WMS texture to memory
-          mTexturesBuffer.insert(std::pair<std::string, std::future<unsigned char*>>(
-              fileIt->first, mTextureLoader.loadTextureFromFileAsync(fileName)));
-        } else {
-          fileError = true;
-        }
+    // Let the planner select the WMS textures to be downloaded based on the direction and speed
+    // of the playback. If no pre-fetch is set, only the texture for the current timestep is
+    // selected. The offsets skip gaps between intervals.
+    int     duration       = current ? mTimeIndex.getDuration(*current) : 0;
+    int64_t anchorStep     = 0;
+    double  stepsPerSecond = 0.0;
+    if (anchor && mTimeIndex.getDuration(*anchor) != 0) {
+      anchorStep     = anchor->mStep;
+      stepsPerSecond = mTimeControl->pTimeSpeed.get() / mTimeIndex.getDuration(*anchor);
+    }
+
+    mPrefetchPlanner.plan(anchorStep, stepsPerSecond, mPrefetchOffsets);
+    mRequestWindow.clear();
 
-        fileIt = mTextureFilesBuffer.erase(fileIt);
+    for (size_t urgency = 0; anchor && urgency < mPrefetchOffsets.size(); ++urgency) {
+      auto timestep = mTimeIndex.offset(*anchor, mPrefetchOffsets[urgency]);
+      if (!timestep) {
+        continue;
+      }
+
+      // Several offsets may map to the same texture, the most urgent one determines the priority.
+      int  priority = getRequestPriority(static_cast<int>(urgency));
+      auto window   = std::find_if(mRequestWindow.begin(), mRequestWindow.end(),
+          [&timestep](auto const& entry) { return entry.first == *timestep; });
+      if (window == mRequestWindow.end()) {
+        mRequestWindow.emplace_back(*timestep, priority);
       } else {
-        ++fileIt;
+        window->second = std::max(window->second, priority);
       }
     }
 
-    // Check whether the WMS textures are loaded to the memory.
-    auto texIt = mTexturesBuffer.begin();
-    while (texIt != mTexturesBuffer.end()) {
-      if (texIt->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
-        mTextures.insert(std::pair<std::string, unsigned char*>(texIt->first, texIt->second.get()));
-        texIt = mTexturesBuffer.erase(texIt);
+    // Cancel all requests which are not part of the pre-fetch window anymore. This also aborts
+    // downloads which are currently in progress.
+    auto requestIt = mRequests.begin();
+    while (requestIt != mRequests.end()) {
+      auto window = std::find_if(mRequestWindow.begin(), mRequestWindow.end(),
+          [&requestIt](auto const& entry) { return entry.first == requestIt->mTimestep; });
+      if (window == mRequestWindow.end()) {
+        requestIt->mHandle->cancel();
+        requestIt = mRequests.erase(requestIt);
       } else {
-        ++texIt;
+        ++requestIt;
+      }
+    }
+
+    // Pending requests are re-prioritized as the window moves, the others are only loaded if
+    // they aren't stored yet. Only here the timesteps have to be converted to strings.
+    for (auto const& [timestep, priority] : mRequestWindow) {
+      switch (getState(timestep)) {
+      case TimestepState::eNone:
+        requestTexture(timestep, priority);
+        break;
+      case TimestepState::eRequested: {
+        auto request = std::find_if(mRequests.begin(), mRequests.end(),
+            [&timestep](Request const& r) { return r.mTimestep == timestep; });
+        request->mHandle->setPriority(priority);
+        break;
+      }
+      default:
+        break;
       }
     }
 
-    time = cs::utils::convert::time::toPosix(mTimeControl->pSimulationTime.get());
-    boost::posix_time::time_duration timeSinceStart;
-    boost::posix_time::ptime         startTime =
-        time - boost::posix_time::microseconds(time.time_of_day().fractional_seconds());
-    bool inInterval = utils::timeInIntervals(
-        startTime, mTimeIntervals, timeSinceStart, mIntervalDuration, mFormat);
+    bool fileError = !receiveTextures();
+
+    // The interpolation partner is the following timestep. The timestep after it is uploaded
+    // ahead of time, so that advancing by one step does not have to wait for an upload.
+    Timestep second, next;
+    if (duration != 0) {
+      second = mTimeIndex.offset(*current, 1).value_or(Timestep());
 
-    if (mIntervalDuration != 0) {
-      startTime -= boost::posix_time::seconds(timeSinceStart.total_seconds() % mIntervalDuration);
+      if (mPluginSettings->mEnableInterpolation.get()) {
+        next = mTimeIndex.offset(*current, mTimeControl->pTimeSpeed.get() >= 0.f ? 2 : -1)
+                   .value_or(Timestep());
+      }
+    }
+
+    // The current texture and its interpolation partner must stay in the cache. The pins only
+    // have to be updated when the timestep changes.
+    std::array<Timestep, 3> pinned{current.value_or(Timestep()), second, next};
+    if (pinned != mPinnedTimesteps) {
+      mPinnedTimesteps = pinned;
+      mTextures.setPinned({pinned[0], pinned[1]});
+      mGPUTextures.setPinned({pinned.begin(), pinned.end()});
+
+      // Uploads of textures which are not needed anymore are cancelled.
+      mUploader.retain({pinned.begin(), pinned.end()});
     }
-    boost::posix_time::time_duration timeDuration = boost::posix_time::seconds(mIntervalDuration);
-    std::string                      timeString   = utils::timeToString(mFormat.c_str(), startTime);
 
-    if (mPluginSettings->mEnableTimespan.get() && mIntervalDuration != 0) {
-      boost::posix_time::ptime intervalAfter = getStartTime(startTime + timeDuration);
-      timeString += "/" + utils::timeToString(mFormat.c_str(), intervalAfter);
+    // The remaining uploads are advanced by a few rows each frame.
+    mGPUTextures.setCapacity(mPluginSettings->mGPUTextureFrames.get());
+    mUploader.update(static_cast<size_t>(mPluginSettings->mMaxUploadPerFrame.get()) * 1024 * 1024);
+
+    if (next != Timestep()) {
+      getGPUTexture(next);
     }
-    auto tex = mTextures.find(timeString);
 
     // Use Wms texture inside the interval.
-    if (inInterval && !fileError) {
-      // Only update if we have a new texture.
-      if (mCurrentTexture != timeString && tex != mTextures.end()) {
+    if (current && !fileError) {
+      // The previous texture is shown until the new one is completely uploaded. This also
+      // replaces the current texture once a version with more detail is available.
+      auto texture = getGPUTexture(*current);
+      if (texture) {
         mWMSTextureUsed = true;
-        mWMSTexture->UploadTexture(mActiveWMS.mWidth, mActiveWMS.mHeight, tex->second, false);
-        mCurrentTexture = timeString;
+        mWMSTexture     = texture;
+        mCurrentTexture = *current;
       }
     } // Use default planet texture instead.
     else {
       mWMSTextureUsed = false;
     }
 
-    if (!mWMSTextureUsed || !mPluginSettings->mEnableInterpolation.get() ||
-        mIntervalDuration == 0) {
+    if (!mWMSTextureUsed || !mPluginSettings->mEnableInterpolation.get() || second == Timestep()) {
       mSecondWMSTextureUsed = false;
-      mCurrentSecondTexture = "";
+      mCurrentSecondTexture = Timestep();
     } // Create fading between Wms textures when interpolation is enabled.
     else {
-      boost::posix_time::ptime intervalAfter = getStartTime(startTime + timeDuration);
-      tex = mTextures.find(utils::timeToString(mFormat.c_str(), intervalAfter));
-
-      if (tex != mTextures.end()) {
-        // Only update if we ha a new second texture.
-        if (mCurrentSecondTexture != utils::timeToString(mFormat.c_str(), intervalAfter)) {
-          mSecondWMSTexture->UploadTexture(
-              mActiveWMS.mWidth, mActiveWMS.mHeight, tex->second, false);
-          mCurrentSecondTexture = utils::timeToString(mFormat.c_str(), intervalAfter);
-          mSecondWMSTextureUsed = true;
-        }
+      // If the following timestep is behind a gap, the fading is finished at the end of the
+      // current timestep.
+      boost::posix_time::ptime startTime     = mTimeIndex.getStartTime(*current);
+      boost::posix_time::ptime intervalAfter = startTime + boost::posix_time::seconds(duration);
+
+      auto texture = getGPUTexture(second);
+      if (texture) {
+        mSecondWMSTexture     = texture;
+        mCurrentSecondTexture = second;
+        mSecondWMSTextureUsed = true;
+      }
+
+      if (mCurrentSecondTexture == second) {
         // Interpolate fade value between the 2 WMS textures.
         mFade = static_cast<float>((double)(intervalAfter - time).total_seconds() /
                                    (double)(intervalAfter - startTime).total_seconds());
+        mFade = std::clamp(mFade, 0.f, 1.f);
       }
     }
+  } else if (mWMSTextureRequested) {
+    // Data sets without time consist of a single texture. Until it has been loaded and uploaded,
+    // only the background texture is shown.
+    receiveTextures();
+    mUploader.update(static_cast<size_t>(mPluginSettings->mMaxUploadPerFrame.get()) * 1024 * 1024);
+
+    auto texture = getGPUTexture(STATIC_TEXTURE);
+    if (texture) {
+      mWMSTexture     = texture;
+      mWMSTextureUsed = true;
+    }
+  }
+
+  if (mGeometryDirty) {
+    // Each level of detail has half the resolution of the previous one.
+    uint32_t minResolutionX = std::min(mGridResolutionX, MIN_GRID_RESOLUTION);
+    uint32_t minResolutionY = std::min(mGridResolutionY, MIN_GRID_RESOLUTION / 2);
+
+    mGeometryLODs.clear();
+    for (uint32_t i = 0; i < GEOMETRY_LODS; ++i) {
+      mGeometryLODs.push_back(SphereGeometry::get(
+          std::max(mGridResolutionX >> i, minResolutionX),
+          std::max(mGridResolutionY >> i, minResolutionY)));
+    }
+
+    mGeometryDirty = false;
   }
 
   if (mShaderDirty) {
@@ -430,10 +586,23 @@ bool SimpleWMSBody::Do() {
       defines += "#define ENABLE_LIGHTING\n";
     }
 
-    mShader.InitVertexShaderFromString(defines + SPHERE_VERT);
-    mShader.InitFragmentShaderFromString(defines + SPHERE_FRAG);
+    mShader.InitVertexShaderFromString(defines + FRAME_DATA + SPHERE_VERT);
+    mShader.InitFragmentShaderFromString(defines + FRAME_DATA + SPHERE_FRAG);
     mShader.Link();
 
+    // The samplers always use the same texture units, so they only have to be set once.
+    mShader.Bind();
+    mShader.SetUniform(mShader.GetUniformLocation("uBackgroundTexture"), 0);
+    mShader.SetUniform(mShader.GetUniformLocation("uWMSTexture"), 1);
+    mShader.SetUniform(mShader.GetUniformLocation("uSecondWMSTexture"), 2);
+    mShader.SetUniform(mShader.GetUniformLocation("uTileAtlas"), 3);
+    mShader.SetUniform(mShader.GetUniformLocation("uTileIndex"), 4);
+    mShader.Release();
+
+    GLuint program = mShader.GetProgram();
+    glUniformBlockBinding(
+        program, glGetUniformBlockIndex(program, "FrameData"), FRAME_DATA_BINDING);
+
     mShaderDirty = false;
   }
 
@@ -463,30 +632,37 @@ bool SimpleWMSBody::Do() {
     sunDirection = mSolarSystem->getSunDirection(getWorldTransform()[3]);
   }
 
-  // Set uniforms.
-  mShader.SetUniform(mShader.GetUniformLocation("uSunDirection"), sunDirection[0], sunDirection[1],
-      sunDirection[2]);
-  mShader.SetUniform(mShader.GetUniformLocation("uSunIlluminance"), sunIlluminance);
-  mShader.SetUniform(mShader.GetUniformLocation("uAmbientBrightness"), ambientBrightness);
-  mShader.SetUniform(mShader.GetUniformLocation("uUseTexture"), mWMSTextureUsed);
-  mShader.SetUniform(mShader.GetUniformLocation("uUseSecondTexture"), mSecondWMSTextureUsed);
-
   // Get modelview and projection matrices.
   GLfloat glMatMV[16], glMatP[16];
   glGetFloatv(GL_MODELVIEW_MATRIX, &glMatMV[0]);
   glGetFloatv(GL_PROJECTION_MATRIX, &glMatP[0]);
   auto matMV = glm::make_mat4x4(glMatMV) * glm::mat4(getWorldTransform());
-  glUniformMatrix4fv(
-      mShader.GetUniformLocation("uMatModelView"), 1, GL_FALSE, glm::value_ptr(matMV));
-  glUniformMatrix4fv(mShader.GetUniformLocation("uMatProjection"), 1, GL_FALSE, glMatP);
-
-  mShader.SetUniform(mShader.GetUniformLocation("uBackgroundTexture"), 0);
-  mShader.SetUniform(mShader.GetUniformLocation("uWMSTexture"), 1);
-  mShader.SetUniform(mShader.GetUniformLocation("uSecondWMSTexture"), 2);
-  mShader.SetUniform(
-      mShader.GetUniformLocation("uRadii"), (float)mRadii[0], (float)mRadii[0], (float)mRadii[0]);
-  mShader.SetUniform(
-      mShader.GetUniformLocation("uFarClip"), cs::utils::getCurrentFarClipDistance());
+
+  // Set uniforms.
+  FrameData frameData{};
+  std::copy_n(glm::value_ptr(matMV), 16, frameData.mMatModelView);
+  std::copy_n(glMatP, 16, frameData.mMatProjection);
+  std::copy_n(&sunDirection[0], 3, frameData.mSunDirection);
+  frameData.mSunIlluminance    = sunIlluminance;
+  frameData.mRadii[0]          = static_cast<float>(mRadii[0]);
+  frameData.mRadii[1]          = static_cast<float>(mRadii[0]);
+  frameData.mRadii[2]          = static_cast<float>(mRadii[0]);
+  frameData.mAmbientBrightness = ambientBrightness;
+  frameData.mFarClip           = cs::utils::getCurrentFarClipDistance();
+  frameData.mFade              = mSecondWMSTextureUsed ? mFade : 0.f;
+  frameData.mUseTexture        = mWMSTextureUsed;
+  frameData.mUseSecondTexture  = mSecondWMSTextureUsed;
+  frameData.mUseTiles          = mTilesUsed;
+
+  if (mTilesUsed) {
+    frameData.mTileAtlasSlots = static_cast<float>(mTiles->getAtlasSlots());
+    frameData.mTileSize       = static_cast<float>(mTiles->getTileSize());
+  }
+
+  glBindBuffer(GL_UNIFORM_BUFFER, mFrameDataBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &frameData);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, mFrameDataBuffer);
 
   // Only bind the enabled textures.
   mBackgroundTexture->Bind(GL_TEXTURE0);
@@ -494,16 +670,16 @@ bool SimpleWMSBody::Do() {
     mWMSTexture->Bind(GL_TEXTURE1);
 
     if (mSecondWMSTextureUsed) {
-      mShader.SetUniform(mShader.GetUniformLocation("uFade"), mFade);
       mSecondWMSTexture->Bind(GL_TEXTURE2);
     }
   }
 
+  if (mTilesUsed) {
+    mTiles->bind(GL_TEXTURE3, GL_TEXTURE4);
+  }
+
   // Draw.
-  mSphereVAO.Bind();
-  glDrawElements(GL_TRIANGLE_STRIP, (mGridResolutionX - 1) * (2 + 2 * mGridResolutionY),
-      GL_UNSIGNED_INT, nullptr);
-  mSphereVAO.Release();
+  mGeometryLODs[getGeometryLOD()]->draw();
 
   // Clean up.
   mBackgroundTexture->Unbind(GL_TEXTURE0);
@@ -516,6 +692,10 @@ bool SimpleWMSBody::Do() {
     }
   }
 
+  if (mTilesUsed) {
+    mTiles->unbind(GL_TEXTURE3, GL_TEXTURE4);
+  }
+
   mShader.Release();
 
   return true;
@@ -529,47 +709,295 @@ bool SimpleWMSBody::GetBoundingBox(VistaBoundingBox& bb) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-boost::posix_time::ptime SimpleWMSBody::getStartTime(boost::posix_time::ptime time) {
-  boost::posix_time::time_duration timeSinceStart;
-  bool                             inInterval =
-      utils::timeInIntervals(time, mTimeIntervals, timeSinceStart, mIntervalDuration, mFormat);
-  boost::posix_time::ptime startTime =
-      time - boost::posix_time::seconds(timeSinceStart.total_seconds() % mIntervalDuration);
-  return startTime;
+SimpleWMSBody::TimestepState SimpleWMSBody::getState(Timestep const& timestep) const {
+  // A texture with less detail than currently requested has to be loaded again.
+  if (mGPUTextures.contains(timestep) &&
+      mGPUTextures.getResolutionLevel(timestep) <= mResolutionLevel) {
+    return TimestepState::eUploaded;
+  }
+
+  if (mUploader.isPending(timestep)) {
+    return TimestepState::eUploading;
+  }
+
+  if (mTextures.contains(timestep)) {
+    return TimestepState::eDecoded;
+  }
+
+  if (std::any_of(mRequests.begin(), mRequests.end(),
+          [&timestep](Request const& r) { return r.mTimestep == timestep; })) {
+    return TimestepState::eRequested;
+  }
+
+  return TimestepState::eNone;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void SimpleWMSBody::setActiveWMS(Plugin::Settings::WMSConfig const& wms) {
+void SimpleWMSBody::requestTexture(Timestep const& timestep, int priority) {
+  // Only textures of time-series data sets are requested with a time.
+  std::string time = mActiveWMS.mTime.has_value() ? mTimeIndex.format(timestep, mTimespan) : "";
+
+  auto handle = std::make_shared<PriorityThreadPool::TaskHandle>(priority);
+  mRequests.push_back({timestep, handle,
+      mTextureLoader->loadTextureAsync(
+          time, mRequest, mCacheLayer, mPluginSettings->mMapCache.get(), handle),
+      std::chrono::steady_clock::now()});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool SimpleWMSBody::receiveTextures() {
+  bool success = true;
+
+  auto request = mRequests.begin();
+  while (request != mRequests.end()) {
+    if (request->mTexture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      DecodedTexture texture = request->mTexture.get();
+
+      if (texture.mData) {
+        // The time it took to load the texture is used to size the pre-fetch window.
+        std::chrono::duration<double> latency =
+            std::chrono::steady_clock::now() - request->mStartTime;
+        mPrefetchPlanner.addLatencySample(latency.count());
+
+        mTextures.insert(request->mTimestep, std::move(texture));
+      } else {
+        success = false;
+      }
+
+      request = mRequests.erase(request);
+    } else {
+      ++request;
+    }
+  }
+
+  return success;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimpleWMSBody::clearTimesteps() {
+  for (auto const& request : mRequests) {
+    request.mHandle->cancel();
+  }
+
+  mRequests.clear();
   mTextures.clear();
-  mTextureFilesBuffer.clear();
-  mTexturesBuffer.clear();
-  mTimeIntervals.clear();
+  mUploader.retain({});
+  mGPUTextures.clear();
+  mPinnedTimesteps.fill(Timestep());
+  mTileTimestep = Timestep();
+
   mWMSTextureUsed       = false;
   mSecondWMSTextureUsed = false;
-  mCurrentTexture       = "";
-  mCurrentSecondTexture = "";
-  mActiveWMS            = wms;
+  mCurrentTexture       = Timestep();
+  mCurrentSecondTexture = Timestep();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<VistaTexture> SimpleWMSBody::getGPUTexture(Timestep const& timestep) {
+  auto texture       = mGPUTextures.get(timestep);
+  int  requiredLevel = getRequiredResolutionLevel();
+
+  // Returns how often the configured width has been halved to get the given width.
+  auto getLevel = [this](int width) {
+    int level = 0;
+    while (level < 30 && (mActiveWMS.mWidth >> level) > width) {
+      ++level;
+    }
+    return level;
+  };
+
+  // A texture with less detail is used until a sharper version has been uploaded.
+  if (texture && mGPUTextures.getResolutionLevel(timestep) <= requiredLevel) {
+    return texture;
+  }
+
+  auto uploaded = mUploader.take(timestep);
+
+  if (uploaded.mTexture) {
+    mGPUTextures.insert(timestep, uploaded.mTexture, getLevel(uploaded.mWidth));
+    return uploaded.mTexture;
+  }
+
+  if (getState(timestep) == TimestepState::eDecoded) {
+    auto const* decoded = mTextures.get(timestep);
+    mUploader.upload(timestep, *decoded, std::max(0, requiredLevel - getLevel(decoded->mWidth)));
+  }
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimpleWMSBody::getViewParameters(glm::dvec3& observer, double& pixelScale) const {
+  GLfloat glMatMV[16], glMatP[16];
+  GLint   viewport[4];
+  glGetFloatv(GL_MODELVIEW_MATRIX, &glMatMV[0]);
+  glGetFloatv(GL_PROJECTION_MATRIX, &glMatP[0]);
+  glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+
+  glm::dmat4 matMV = glm::dmat4(glm::make_mat4x4(glMatMV)) * getWorldTransform();
+  observer         = glm::inverse(matMV) * glm::dvec4(0.0, 0.0, 0.0, 1.0);
+  pixelScale       = 0.5 * viewport[3] * glMatP[5];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int SimpleWMSBody::getRequiredResolutionLevel() const {
+  // The visible hemisphere shows half of the texture width across the diameter of the body, but
+  // the texels in its center are stretched by a factor of pi / 2.
+  double requiredWidth = glm::pi<double>() * mScreenSize;
+  int    level         = 0;
+
+  while ((mActiveWMS.mWidth >> (level + 1)) >= requiredWidth &&
+         (mActiveWMS.mWidth >> (level + 1)) > 0) {
+    ++level;
+  }
+
+  return level;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t SimpleWMSBody::getGeometryLOD() const {
+  // The edges of the grid along the equator should be at most a few pixels long.
+  double requiredResolution = glm::pi<double>() * mScreenSize / MAX_EDGE_LENGTH;
+  size_t lod                = 0;
+
+  while (lod + 1 < mGeometryLODs.size() &&
+         mGeometryLODs[lod + 1]->getResolutionX() >= requiredResolution) {
+    ++lod;
+  }
+
+  return lod;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimpleWMSBody::setResolutionLevel(int level) {
+  for (auto const& request : mRequests) {
+    request.mHandle->cancel();
+  }
+
+  // Textures which are on the GPU already are kept until they are replaced.
+  mRequests.clear();
+  mTextures.clear();
+  mPinnedTimesteps.fill(Timestep());
+  mResolutionLevel = level;
+
+  int width  = std::max(1, mActiveWMS.mWidth >> level);
+  int height = std::max(1, mActiveWMS.mHeight >> level);
 
   // Create request URL for map server.
   std::stringstream url;
-  url << mActiveWMS.mUrl << "&WIDTH=" << mActiveWMS.mWidth << "&HEIGHT=" << mActiveWMS.mHeight
+  url << mActiveWMS.mUrl << "&WIDTH=" << width << "&HEIGHT=" << height
       << "&LAYERS=" << mActiveWMS.mLayers;
   mRequest = url.str();
 
+  // Reduced images are stored in a subdirectory of the layer in the map cache.
+  mCacheLayer = mActiveWMS.mLayers;
+  if (level > 0) {
+    mCacheLayer += "/" + std::to_string(width) + "x" + std::to_string(height);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimpleWMSBody::updateTiles() {
+  mWMSTextureUsed       = false;
+  mSecondWMSTextureUsed = false;
+
+  // Tiles are only loaded for the current timestep. Interpolation and pre-fetching are not
+  // supported in tile mode.
+  std::optional<Timestep> current;
+  if (mActiveWMS.mTime.has_value()) {
+    current = mTimeIndex.find(
+        cs::utils::convert::time::toPosix(mTimeControl->pSimulationTime.get()));
+
+    if (!current) {
+      mTilesUsed = false;
+      return;
+    }
+  }
+
+  // The name of the timestep is only formatted when it changes.
+  if (!current) {
+    mTileTimeString.clear();
+  } else if (*current != mTileTimestep) {
+    mTileTimeString = mTimeIndex.format(*current, mTimespan);
+  }
+  mTileTimestep = current.value_or(Timestep());
+
+  // The tiles are selected based on the position of the observer in the coordinate system of the
+  // body and the size of a pixel at unit distance.
+  glm::dvec3 observer;
+  double     pixelScale;
+  getViewParameters(observer, pixelScale);
+
+  mTiles->update(mTileTimeString, observer, mRadii, pixelScale, getRequestPriority(0),
+      mPluginSettings->mMapCache.get(),
+      static_cast<size_t>(mPluginSettings->mMaxUploadPerFrame.get()) * 1024 * 1024);
+
+  mTilesUsed = mTiles->isReady();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int SimpleWMSBody::getRequestPriority(int urgency) const {
+  // Textures of the active body are always loaded before textures of other bodies. Within one
+  // body, the order chosen by the pre-fetch planner is used.
+  int priority = -urgency;
+
+  if (mSolarSystem->pActiveBody.get().get() == this) {
+    priority += 1 << 16;
+  }
+
+  return priority;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SimpleWMSBody::setActiveWMS(Plugin::Settings::WMSConfig const& wms) {
+  auto statistics = mTextures.getStatistics();
+  logger().debug("Texture cache of '{}': {} hits, {} misses, {} evictions.", getCenterName(),
+      statistics.mHits, statistics.mMisses, statistics.mEvictions);
+
+  clearTimesteps();
+  mTimeIntervals.clear();
+  mTilesUsed           = false;
+  mWMSTextureRequested = false;
+  mTimespan  = mPluginSettings->mEnableTimespan.get();
+  mActiveWMS = wms;
+
+  mPrefetchPlanner.setPrefetchCount(mActiveWMS.mPrefetchCount.value_or(0));
+  mPrefetchPlanner.resetLatency();
+
+  // Start with the full resolution. For time-dependent data sets, Do() adapts it to the size of
+  // the body on screen.
+  setResolutionLevel(0);
+
+  // In tile mode, the size and extent of each request is chosen by the TileStreamer.
+  if (mActiveWMS.mMaxTileLevel.has_value()) {
+    mTiles = std::make_unique<TileStreamer>(mTextureLoader,
+        mActiveWMS.mUrl + "&LAYERS=" + mActiveWMS.mLayers, mActiveWMS.mLayers,
+        mActiveWMS.mTileSize.value_or(256), mActiveWMS.mMaxTileLevel.value());
+  } else {
+    mTiles.reset();
+  }
+
   // Set time intervals and format if it is defined in config.
   if (mActiveWMS.mTime.has_value()) {
     utils::parseIsoString(mActiveWMS.mTime.value(), mTimeIntervals);
-    mIntervalDuration = mTimeIntervals.at(0).mIntervalDuration;
-    mFormat           = mTimeIntervals.at(0).mFormat;
-  } // Download WMS texture without timestep.
-  else {
-    std::string cacheFile = mTextureLoader.loadTexture(
-        "", mRequest, mActiveWMS.mLayers, mPluginSettings->mMapCache.get());
-    if (cacheFile != "Error") {
-      mWMSTexture     = cs::graphics::TextureLoader::loadFromFile(cacheFile);
-      mWMSTextureUsed = true;
-    }
+    mTimeIndex = TimeIndex(mTimeIntervals);
+  } // Request the WMS texture without timestep. It is loaded in the background.
+  else if (!mTiles) {
+    mTextures.setPinned({STATIC_TEXTURE});
+    mGPUTextures.setPinned({STATIC_TEXTURE});
+    requestTexture(STATIC_TEXTURE, getRequestPriority(0));
+    mWMSTextureRequested = true;
   }
 }
 
@@ -9,15 +9,23 @@
 
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 #include <VistaKernel/GraphicsManager/VistaOpenGLNode.h>
-#include <VistaOGLExt/VistaBufferObject.h>
 #include <VistaOGLExt/VistaGLSLShader.h>
-#include <VistaOGLExt/VistaVertexArrayObject.h>
 
 #include "../../../src/cs-scene/CelestialBody.hpp"
 #include "Plugin.hpp"
+#include "PrefetchPlanner.hpp"
+#include "SphereGeometry.hpp"
+#include "TextureCache.hpp"
+#include "TextureRegistry.hpp"
+#include "TextureRing.hpp"
+#include "TextureUploader.hpp"
+#include "TileStreamer.hpp"
+#include "TimeIndex.hpp"
 #include "WebMapTextureLoader.hpp"
 #include "utils.hpp"
 
+#include <array>
+
 namespace cs::core {
 class SolarSystem;
 class TimeControl;
@@ -35,6 +43,8 @@ class SimpleWMSBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
   SimpleWMSBody(std::shared_ptr<cs::core::Settings> const& settings,
       std::shared_ptr<cs::core::SolarSystem>               solarSystem,
       std::shared_ptr<Plugin::Settings> const&             pluginSettings,
+      std::shared_ptr<WebMapTextureLoader>                 textureLoader,
+      std::shared_ptr<TextureRegistry>                     textureRegistry,
       std::shared_ptr<cs::core::TimeControl> timeControl, std::string const& sCenterName,
       std::string const& sFrameName, double tStartExistence, double tEndExistence);
 
@@ -46,9 +56,22 @@ class SimpleWMSBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
 
   ~SimpleWMSBody() override;
 
+  /// Starts decoding the background texture of the given settings on the decode threads if it is
+  /// not resident in the TextureRegistry. The result is picked up by the next call to configure(),
+  /// so calling this for all bodies first decodes their textures in parallel.
+  void prepare(Plugin::Settings::SimpleWMSBody const& settings);
+
   /// Configures the internal renderer according to the given values.
   void configure(Plugin::Settings::SimpleWMSBody const& settings);
 
+  /// Time spent in the last call to configure() in milliseconds.
+  struct StartupTimings {
+    double mWaitTime   = 0.0; ///< Waiting for the background texture to be decoded.
+    double mUploadTime = 0.0; ///< Uploading the background texture.
+  };
+
+  StartupTimings const& getStartupTimings() const;
+
   /// The sun object is used for lighting computation.
   void setSun(std::shared_ptr<const cs::scene::CelestialObject> const& sun);
 
@@ -78,48 +101,147 @@ class SimpleWMSBody : public cs::scene::CelestialBody, public IVistaOpenGLDraw {
 
   std::unique_ptr<VistaOpenGLNode> mGLNode;
 
-  glm::dvec3 mRadii;
-  std::mutex mWMSMutex;
+  glm::dvec3  mRadii;
+  std::string mTimerName; ///< The frame timer of each body measures the CPU time spent in Do().
+  std::mutex  mWMSMutex;
 
   std::shared_ptr<Plugin::Settings> mPluginSettings;
   Plugin::Settings::SimpleWMSBody   mSimpleWMSBodySettings;
   Plugin::Settings::WMSConfig       mActiveWMS; ///< WMS config of the active WMS data set.
 
   std::shared_ptr<VistaTexture> mBackgroundTexture; ///< The background texture of the body.
+  StartupTimings                mStartupTimings;
   std::shared_ptr<VistaTexture> mWMSTexture;        ///< The WMS texture.
   std::shared_ptr<VistaTexture> mSecondWMSTexture;  ///< Second WMS texture for time interpolation.
-  bool                          mWMSTextureUsed;    ///< Whether to use the WMS texture.
+  bool                          mWMSTextureUsed = false; ///< Whether to use the WMS texture.
   bool        mSecondWMSTextureUsed = false;        ///< Whether to use the second WMS texture.
-  std::string mCurrentTexture;                      ///< Timestep of the current WMS texture.
-  std::string mCurrentSecondTexture;                ///< Timestep of the second WMS texture.
+  Timestep    mCurrentTexture;                      ///< Timestep of the current WMS texture.
+  Timestep    mCurrentSecondTexture;                ///< Timestep of the second WMS texture.
   float       mFade;                                ///< Fading value between WMS textures.
   std::string mRequest;                             ///< WMS server request URL.
-  std::string mFormat;                              ///< Time format style.
-  int         mIntervalDuration;                    ///< Duration of the current time interval.
+  std::string mCacheLayer;                          ///< Layer name used in the map cache.
+  int         mResolutionLevel = 0; ///< The requested size is the configured one divided by 2^n.
   std::vector<TimeInterval> mTimeIntervals;         ///< Time intervals of data set.
-
-  std::map<std::string, std::future<std::string>>    mTextureFilesBuffer;
-  std::map<std::string, std::future<unsigned char*>> mTexturesBuffer;
-  std::map<std::string, unsigned char*>              mTextures;
-
-  VistaGLSLShader        mShader;
-  VistaVertexArrayObject mSphereVAO;
-  VistaBufferObject      mSphereVBO;
-  VistaBufferObject      mSphereIBO;
-
-  WebMapTextureLoader mTextureLoader;
+  TimeIndex                 mTimeIndex;             ///< Lookup structure for mTimeIntervals.
+
+  bool                      mTimespan = false;      ///< Whether timesteps are requested as spans.
+
+  /// The stages a timestep of a time-series data set goes through. Each stage is tracked by one
+  /// member: mRequests, mTextures, mUploader and mGPUTextures.
+  enum class TimestepState {
+    eNone,      ///< The timestep has not been requested yet or it has been evicted.
+    eRequested, ///< The texture is downloaded and decoded by the texture loader.
+    eDecoded,   ///< The decoded texture is stored in mTextures.
+    eUploading, ///< The texture is transferred to the GPU by mUploader.
+    eUploaded   ///< The texture is stored in mGPUTextures with the requested detail.
+  };
+
+  /// A texture which is currently downloaded and decoded.
+  struct Request {
+    Timestep                              mTimestep;
+    WebMapTextureLoader::RequestHandle    mHandle;    ///< Used to re-prioritize or cancel.
+    std::future<DecodedTexture>           mTexture;   ///< Becomes ready once it is decoded.
+    std::chrono::steady_clock::time_point mStartTime; ///< Used to measure the loading latency.
+  };
+
+  /// There are only a few requests at a time, so they are searched linearly.
+  std::vector<Request> mRequests;
+  TextureCache         mTextures;
+  PrefetchPlanner      mPrefetchPlanner;
+
+  /// These are rebuilt every frame. They are members so that their memory is reused.
+  std::vector<int>                      mPrefetchOffsets;
+  std::vector<std::pair<Timestep, int>> mRequestWindow;
+
+  /// The timesteps which are currently pinned in the caches: the current one, its interpolation
+  /// partner and the one which is uploaded ahead of time.
+  std::array<Timestep, 3> mPinnedTimesteps;
+
+  /// The name of the timestep which is currently streamed in tile mode.
+  Timestep    mTileTimestep;
+  std::string mTileTimeString;
+
+  VistaGLSLShader mShader;
+  GLuint          mFrameDataBuffer = 0; ///< Uniform buffer for the FrameData block.
+
+  /// The sphere geometry with decreasing resolution. The first one uses the configured resolution.
+  /// The geometries are shared with other bodies.
+  std::vector<std::shared_ptr<SphereGeometry>> mGeometryLODs;
+
+  std::shared_ptr<WebMapTextureLoader> mTextureLoader;
+  std::shared_ptr<TextureRegistry>     mTextureRegistry;
+  TextureUploader                      mUploader;
+  TextureRing                          mGPUTextures; ///< Uploaded textures of recent timesteps.
+  std::unique_ptr<TileStreamer>        mTiles;       ///< Only set if the data set uses tile mode.
+  bool                                 mTilesUsed  = false;
+  double                               mScreenSize = 0.0; ///< The diameter on screen in pixels.
 
   bool mShaderDirty              = true;
+  bool mGeometryDirty            = true;
+  bool mWMSTextureRequested      = false; ///< Whether a data set without time is loaded.
   int  mEnableLightingConnection = -1;
   int  mEnableHDRConnection      = -1;
 
   uint32_t mGridResolutionX = 200;
   uint32_t mGridResolutionY = 100;
 
+  /// The smallest width of a WMS image which is requested for a body which is small on screen.
+  static const int MIN_REQUEST_SIZE;
+
+  /// The number of geometry levels of detail, the smallest grid resolution of the coarsest level
+  /// and the maximum length of a grid edge on screen in pixels.
+  static const uint32_t GEOMETRY_LODS;
+  static const uint32_t MIN_GRID_RESOLUTION;
+  static const double   MAX_EDGE_LENGTH;
+
+  /// The binding point of the FrameData uniform block.
+  static const GLuint FRAME_DATA_BINDING;
+
+  static const std::string FRAME_DATA;
   static const std::string SPHERE_VERT;
   static const std::string SPHERE_FRAG;
 
-  boost::posix_time::ptime getStartTime(boost::posix_time::ptime time);
+  /// Returns the stage of the loading pipeline the given timestep is in.
+  TimestepState getState(Timestep const& timestep) const;
+
+  /// Starts to download and decode the texture for the given timestep.
+  void requestTexture(Timestep const& timestep, int priority);
+
+  /// Moves all textures which have been decoded since the last call to mTextures. Returns false
+  /// if one of them could not be loaded.
+  bool receiveTextures();
+
+  /// Cancels all requests and removes all textures, for example when the data set changes.
+  void clearTimesteps();
+
+  /// Returns the GPU texture for the given timestep if it has been uploaded already. If there is
+  /// none or if it was uploaded with less detail than currently needed, an upload is started if
+  /// the texture has been decoded.
+  std::shared_ptr<VistaTexture> getGPUTexture(Timestep const& timestep);
+
+  /// Returns the position of the observer in the coordinate system of the body and the size in
+  /// pixels of an object with a size of one at a distance of one.
+  void getViewParameters(glm::dvec3& observer, double& pixelScale) const;
+
+  /// Returns the index of the coarsest geometry which still looks round at the current size of
+  /// the body on screen.
+  size_t getGeometryLOD() const;
+
+  /// Returns how often the configured size of the WMS images can be halved while still providing
+  /// enough detail for the current size of the body on screen.
+  int getRequiredResolutionLevel() const;
+
+  /// Changes the size of the requested WMS images to the configured one divided by 2^level. All
+  /// textures which are loaded or decoded are discarded; uploaded ones are kept until they are
+  /// replaced.
+  void setResolutionLevel(int level);
+
+  /// Selects, loads and uploads the tiles for the current frame if the data set uses tile mode.
+  void updateTiles();
+
+  /// Returns the priority for loading a texture. The urgency is the position of the texture in
+  /// the list of timesteps selected by the pre-fetch planner.
+  int getRequestPriority(int urgency) const;
 };
 
 } // namespace csp::simplewmsbodies
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "SphereGeometry.hpp"
+
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::map<std::pair<uint32_t, uint32_t>, std::weak_ptr<SphereGeometry>> SphereGeometry::sGeometries;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<SphereGeometry> SphereGeometry::get(uint32_t resolutionX, uint32_t resolutionY) {
+  auto& entry    = sGeometries[{resolutionX, resolutionY}];
+  auto  geometry = entry.lock();
+
+  if (!geometry) {
+    geometry = std::make_shared<SphereGeometry>(resolutionX, resolutionY);
+    entry    = geometry;
+  }
+
+  // Remove entries of geometries which are not used anymore.
+  for (auto it = sGeometries.begin(); it != sGeometries.end();) {
+    if (it->second.expired()) {
+      it = sGeometries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return geometry;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SphereGeometry::SphereGeometry(uint32_t resolutionX, uint32_t resolutionY)
+    : mResolutionX(resolutionX)
+    , mResolutionY(resolutionY)
+    , mIndexCount((resolutionX - 1) * (2 + 2 * resolutionY)) {
+
+  std::vector<float>    vertices(mResolutionX * mResolutionY * 2);
+  std::vector<unsigned> indices(mIndexCount);
+
+  for (uint32_t x = 0; x < mResolutionX; ++x) {
+    for (uint32_t y = 0; y < mResolutionY; ++y) {
+      vertices[(x * mResolutionY + y) * 2 + 0] = 1.f / (mResolutionX - 1) * x;
+      vertices[(x * mResolutionY + y) * 2 + 1] = 1.f / (mResolutionY - 1) * y;
+    }
+  }
+
+  uint32_t index = 0;
+
+  for (uint32_t x = 0; x < mResolutionX - 1; ++x) {
+    indices[index++] = x * mResolutionY;
+    for (uint32_t y = 0; y < mResolutionY; ++y) {
+      indices[index++] = x * mResolutionY + y;
+      indices[index++] = (x + 1) * mResolutionY + y;
+    }
+    indices[index] = indices[index - 1];
+    ++index;
+  }
+
+  mVAO.Bind();
+
+  mVBO.Bind(GL_ARRAY_BUFFER);
+  mVBO.BufferData(vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+
+  mIBO.Bind(GL_ELEMENT_ARRAY_BUFFER);
+  mIBO.BufferData(indices.size() * sizeof(unsigned), indices.data(), GL_STATIC_DRAW);
+
+  mVAO.EnableAttributeArray(0);
+  mVAO.SpecifyAttributeArrayFloat(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0, &mVBO);
+
+  mVAO.Release();
+  mIBO.Release();
+  mVBO.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SphereGeometry::draw() {
+  mVAO.Bind();
+  glDrawElements(GL_TRIANGLE_STRIP, static_cast<GLsizei>(mIndexCount), GL_UNSIGNED_INT, nullptr);
+  mVAO.Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t SphereGeometry::getResolutionX() const {
+  return mResolutionX;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t SphereGeometry::getResolutionY() const {
+  return mResolutionY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
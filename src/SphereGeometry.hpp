@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_SPHERE_GEOMETRY_HPP
+#define CSP_WMS_SPHERE_GEOMETRY_HPP
+
+#include <VistaOGLExt/VistaBufferObject.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace csp::simplewmsbodies {
+
+/// For rendering the sphere, we create a 2D-grid which is warped into a sphere in the vertex
+/// shader. The vertex positions are directly used as texture coordinates. The grid is drawn as a
+/// single triangle strip.
+/// As the grid is the same for all bodies, geometries should be obtained with get(), which shares
+/// one set of buffers per resolution between all bodies.
+class SphereGeometry {
+ public:
+  /// Returns the geometry with the given resolution. It is created if no body uses it yet and
+  /// deleted once the last body releases it. This has to be called from the render thread.
+  static std::shared_ptr<SphereGeometry> get(uint32_t resolutionX, uint32_t resolutionY);
+
+  SphereGeometry(uint32_t resolutionX, uint32_t resolutionY);
+
+  SphereGeometry(SphereGeometry const& other) = delete;
+  SphereGeometry(SphereGeometry&& other)      = delete;
+
+  SphereGeometry& operator=(SphereGeometry const& other) = delete;
+  SphereGeometry& operator=(SphereGeometry&& other) = delete;
+
+  ~SphereGeometry() = default;
+
+  /// Draws the grid with the currently bound shader.
+  void draw();
+
+  uint32_t getResolutionX() const;
+  uint32_t getResolutionY() const;
+
+ private:
+  VistaVertexArrayObject mVAO;
+  VistaBufferObject      mVBO;
+  VistaBufferObject      mIBO;
+
+  uint32_t mResolutionX;
+  uint32_t mResolutionY;
+  uint32_t mIndexCount;
+
+  static std::map<std::pair<uint32_t, uint32_t>, std::weak_ptr<SphereGeometry>> sGeometries;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_SPHERE_GEOMETRY_HPP
@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.hpp"
+
+#include "logger.hpp"
+
+#include <algorithm>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::atomic<size_t> TextureCache::sGlobalBudget{0};
+std::atomic<size_t> TextureCache::sGlobalBytes{0};
+
+uint64_t                   TextureCache::sClock = 0;
+std::vector<TextureCache*> TextureCache::sCaches;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureCache::TextureCache() {
+  sCaches.push_back(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureCache::~TextureCache() {
+  clear();
+  sCaches.erase(std::remove(sCaches.begin(), sCaches.end(), this), sCaches.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::setBudget(size_t bytes) {
+  mBudget = bytes;
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::setGlobalBudget(size_t bytes) {
+  sGlobalBudget = bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DecodedTexture const* TextureCache::get(Timestep const& key) {
+  auto it = mEntries.find(key);
+
+  if (it == mEntries.end()) {
+    ++mStatistics.mMisses;
+    return nullptr;
+  }
+
+  ++mStatistics.mHits;
+  mUsage.splice(mUsage.end(), mUsage, it->second.mUsage);
+  it->second.mLastUse = ++sClock;
+
+  return &it->second.mTexture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureCache::contains(Timestep const& key) const {
+  return mEntries.find(key) != mEntries.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::insert(Timestep const& key, DecodedTexture texture) {
+  auto existing = mEntries.find(key);
+  if (existing != mEntries.end()) {
+    erase(existing);
+  }
+
+  size_t bytes = texture.getTotalSize();
+  mBytes += bytes;
+  sGlobalBytes += bytes;
+
+  mUsage.push_back(key);
+  mEntries.emplace(key, Entry{std::move(texture), std::prev(mUsage.end()), ++sClock});
+
+  // Without keeping the new entry, it could be evicted right away. It would then be requested
+  // again in the next frame.
+  evict(key);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::setPinned(std::vector<Timestep> keys) {
+  mPinned = std::move(keys);
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::clear() {
+  sGlobalBytes -= mBytes;
+  mBytes = 0;
+  mEntries.clear();
+  mUsage.clear();
+  mPinned.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureCache::Statistics TextureCache::getStatistics() const {
+  Statistics statistics = mStatistics;
+  statistics.mEntries   = mEntries.size();
+  statistics.mBytes     = mBytes;
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::evict(std::optional<Timestep> const& keep) {
+  // Our own budget is met by removing our own least recently used entries.
+  while (mBudget != 0 && mBytes > mBudget) {
+    auto entry = findEvictable(keep);
+    if (entry == mEntries.end()) {
+      break;
+    }
+
+    erase(entry);
+    ++mStatistics.mEvictions;
+  }
+
+  // For the global budget, the least recently used entry of all caches is removed, no matter
+  // which cache exceeded the budget.
+  size_t globalBudget = sGlobalBudget;
+  while (globalBudget != 0 && sGlobalBytes > globalBudget) {
+    TextureCache*                                 oldestCache = nullptr;
+    std::unordered_map<Timestep, Entry>::iterator oldest;
+
+    for (auto* cache : sCaches) {
+      auto entry = cache->findEvictable(cache == this ? keep : std::nullopt);
+      if (entry != cache->mEntries.end() &&
+          (!oldestCache || entry->second.mLastUse < oldest->second.mLastUse)) {
+        oldestCache = cache;
+        oldest      = entry;
+      }
+    }
+
+    if (!oldestCache) {
+      break;
+    }
+
+    oldestCache->erase(oldest);
+    ++oldestCache->mStatistics.mEvictions;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unordered_map<Timestep, TextureCache::Entry>::iterator TextureCache::findEvictable(
+    std::optional<Timestep> const& keep) {
+  for (auto const& key : mUsage) {
+    if (!isPinned(key) && key != keep) {
+      return mEntries.find(key);
+    }
+  }
+
+  return mEntries.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::erase(std::unordered_map<Timestep, Entry>::iterator it) {
+  size_t bytes = it->second.mTexture.getTotalSize();
+  mBytes -= bytes;
+  sGlobalBytes -= bytes;
+
+  mUsage.erase(it->second.mUsage);
+  mEntries.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureCache::isPinned(Timestep const& key) const {
+  return std::find(mPinned.begin(), mPinned.end(), key) != mPinned.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
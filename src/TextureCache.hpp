@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TEXTURE_CACHE_HPP
+#define CSP_WMS_TEXTURE_CACHE_HPP
+
+#include "TimeIndex.hpp"
+#include "WebMapTextureLoader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+/// An in-memory cache for decoded WMS textures. The cache owns the pixel data of its entries and
+/// evicts the least recently used ones once its own byte budget is exceeded. If the budget shared
+/// by all caches of the plugin is exceeded, the least recently used entry of all caches is evicted,
+/// so a body which has just loaded a texture does not pay for the textures of other bodies.
+/// Pinned entries and the entry which has just been inserted are never evicted.
+/// As entries of other caches may be evicted, all caches have to be used from the same thread.
+class TextureCache {
+ public:
+  /// Counters which can be used to judge the effectiveness of the cache.
+  struct Statistics {
+    uint64_t mHits      = 0; ///< Number of successful lookups.
+    uint64_t mMisses    = 0; ///< Number of lookups for textures which were not in the cache.
+    uint64_t mEvictions = 0; ///< Number of entries which were removed to stay in budget.
+    size_t   mEntries   = 0; ///< Number of entries currently in the cache.
+    size_t   mBytes     = 0; ///< Size of all entries currently in the cache.
+  };
+
+  TextureCache();
+
+  TextureCache(TextureCache const& other) = delete;
+  TextureCache(TextureCache&& other)      = delete;
+
+  TextureCache& operator=(TextureCache const& other) = delete;
+  TextureCache& operator=(TextureCache&& other) = delete;
+
+  ~TextureCache();
+
+  /// Sets the maximum size of this cache in bytes. Zero means that only the global budget applies.
+  void setBudget(size_t bytes);
+
+  /// Sets the maximum size of all caches of the plugin combined in bytes. Zero means unlimited.
+  static void setGlobalBudget(size_t bytes);
+
+  /// Returns the texture stored for the given key and marks it as recently used. Returns nullptr
+  /// if there is no such texture. The returned pointer is valid until the next call to insert(),
+  /// setPinned() or clear() of any cache.
+  DecodedTexture const* get(Timestep const& key);
+
+  /// Returns true if there is a texture for the given key. This does not change the usage order
+  /// and is not counted in the statistics.
+  bool contains(Timestep const& key) const;
+
+  /// Adds a texture to the cache and evicts old entries if the budget is exceeded afterwards. The
+  /// new entry itself is kept even if it is larger than the budget.
+  void insert(Timestep const& key, DecodedTexture texture);
+
+  /// The textures with the given keys will not be evicted until setPinned() is called again.
+  /// Usually these are the texture of the current timestep and its interpolation partner.
+  void setPinned(std::vector<Timestep> keys);
+
+  /// Removes all textures from the cache. The statistics are not reset.
+  void clear();
+
+  Statistics getStatistics() const;
+
+ private:
+  struct Entry {
+    DecodedTexture                mTexture;
+    std::list<Timestep>::iterator mUsage;
+    uint64_t                      mLastUse; ///< The value of sClock when it was last used.
+  };
+
+  /// Evicts entries until both budgets are met again. The entry for the given key is kept.
+  void evict(std::optional<Timestep> const& keep = std::nullopt);
+
+  /// Returns the least recently used entry which is neither pinned nor the given one. Returns
+  /// mEntries.end() if there is none.
+  std::unordered_map<Timestep, Entry>::iterator findEvictable(
+      std::optional<Timestep> const& keep);
+
+  void erase(std::unordered_map<Timestep, Entry>::iterator it);
+  bool isPinned(Timestep const& key) const;
+
+  std::unordered_map<Timestep, Entry> mEntries;
+  std::list<Timestep>                 mUsage; ///< Least recently used keys are at the front.
+  std::vector<Timestep>               mPinned;
+
+  size_t     mBudget = 0;
+  size_t     mBytes  = 0;
+  Statistics mStatistics;
+
+  static std::atomic<size_t> sGlobalBudget;
+  static std::atomic<size_t> sGlobalBytes;
+
+  static uint64_t                   sClock;  ///< Incremented whenever any entry is used.
+  static std::vector<TextureCache*> sCaches; ///< All existing caches.
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_TEXTURE_CACHE_HPP
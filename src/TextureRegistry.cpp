@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TextureRegistry.hpp"
+
+#include "../../../src/cs-graphics/TextureLoader.hpp"
+#include "TextureUploader.hpp"
+
+#include <VistaOGLExt/VistaTexture.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Background textures are needed before any WMS image can be shown.
+const int BACKGROUND_PRIORITY = 1 << 20;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureRegistry::TextureRegistry(std::shared_ptr<WebMapTextureLoader> textureLoader)
+    : mTextureLoader(std::move(textureLoader)) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRegistry::prepare(std::string const& fileName) {
+  Entry& entry = mEntries[getKey(fileName)];
+
+  if (entry.mTexture || entry.mDecode.valid()) {
+    return;
+  }
+
+  // stbi cannot read TIFF images, they are loaded by get() instead.
+  if (boost::algorithm::iends_with(fileName, ".tif") ||
+      boost::algorithm::iends_with(fileName, ".tiff")) {
+    return;
+  }
+
+  entry.mDecode = mTextureLoader->loadFileAsync(
+      fileName, std::make_shared<PriorityThreadPool::TaskHandle>(BACKGROUND_PRIORITY));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRegistry::wait(std::string const& fileName) {
+  auto entry = mEntries.find(getKey(fileName));
+
+  if (entry != mEntries.end() && entry->second.mDecode.valid()) {
+    entry->second.mDecode.wait();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureRegistry::isPending(std::string const& fileName) const {
+  auto entry = mEntries.find(getKey(fileName));
+
+  return entry != mEntries.end() && !entry->second.mTexture && entry->second.mDecode.valid();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<VistaTexture> TextureRegistry::get(std::string const& fileName) {
+  Entry& entry = mEntries[getKey(fileName)];
+
+  if (!entry.mTexture) {
+    DecodedTexture decoded;
+    if (entry.mDecode.valid()) {
+      decoded = entry.mDecode.get();
+    }
+
+    entry.mTexture = decoded.mData ? TextureUploader::uploadNow(decoded)
+                                   : cs::graphics::TextureLoader::loadFromFile(fileName);
+  }
+
+  return entry.mTexture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRegistry::collect() {
+  auto entry = mEntries.begin();
+  while (entry != mEntries.end()) {
+    if (!entry->second.mTexture || entry->second.mTexture.use_count() == 1) {
+      entry = mEntries.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureRegistry::Key TextureRegistry::getKey(std::string const& fileName) {
+  // Files which do not exist get no modification time. Loading them fails later on anyways.
+  boost::system::error_code error;
+  std::time_t               modified = boost::filesystem::last_write_time(fileName, error);
+
+  return {fileName, error ? 0 : modified};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
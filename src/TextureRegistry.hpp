@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TEXTURE_REGISTRY_HPP
+#define CSP_WMS_TEXTURE_REGISTRY_HPP
+
+#include "WebMapTextureLoader.hpp"
+
+#include <ctime>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+class VistaTexture;
+
+namespace csp::simplewmsbodies {
+
+/// The TextureRegistry holds the background textures of all bodies of the plugin. Bodies which use
+/// the same image file share one texture, and textures stay resident when the settings are
+/// reloaded. Textures are identified by their path and the modification time of the file, so an
+/// image which has been changed on disk is loaded again.
+/// The registry keeps a reference to each texture. collect() releases the textures which are not
+/// referenced by any body anymore.
+/// All methods have to be called from the render thread.
+class TextureRegistry {
+ public:
+  explicit TextureRegistry(std::shared_ptr<WebMapTextureLoader> textureLoader);
+
+  /// Starts decoding the given file on the decode threads unless its texture is already resident
+  /// or being decoded.
+  void prepare(std::string const& fileName);
+
+  /// Blocks until a decoding of the given file which was started by prepare() is finished.
+  void wait(std::string const& fileName);
+
+  /// Returns true if prepare() started decoding the current version of the given file and its
+  /// texture has not been uploaded by get() yet.
+  bool isPending(std::string const& fileName) const;
+
+  /// Returns the texture of the given file. If it is not resident yet, the result of prepare() is
+  /// uploaded. Files which have not been prepared or which cannot be decoded by the
+  /// WebMapTextureLoader are loaded with cs::graphics::TextureLoader.
+  std::shared_ptr<VistaTexture> get(std::string const& fileName);
+
+  /// Releases all textures which are only referenced by the registry and all decoded images which
+  /// have not been picked up by get().
+  void collect();
+
+ private:
+  using Key = std::pair<std::string, std::time_t>;
+
+  struct Entry {
+    std::shared_ptr<VistaTexture> mTexture;
+    std::future<DecodedTexture>   mDecode;
+  };
+
+  /// Returns the key of the current version of the given file.
+  static Key getKey(std::string const& fileName);
+
+  std::shared_ptr<WebMapTextureLoader> mTextureLoader;
+  std::map<Key, Entry>                 mEntries;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_TEXTURE_REGISTRY_HPP
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TextureRing.hpp"
+
+#include <algorithm>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureRing::TextureRing(size_t capacity)
+    : mCapacity(capacity) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRing::setCapacity(size_t capacity) {
+  mCapacity = capacity;
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<VistaTexture> TextureRing::get(Timestep const& key) {
+  auto frame = std::find_if(
+      mFrames.begin(), mFrames.end(), [&key](Frame const& f) { return f.mKey == key; });
+
+  if (frame == mFrames.end()) {
+    return nullptr;
+  }
+
+  frame->mLastUsed = ++mUsageCounter;
+  return frame->mTexture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureRing::contains(Timestep const& key) const {
+  return std::any_of(
+      mFrames.begin(), mFrames.end(), [&key](Frame const& f) { return f.mKey == key; });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TextureRing::getResolutionLevel(Timestep const& key) const {
+  auto frame = std::find_if(
+      mFrames.begin(), mFrames.end(), [&key](Frame const& f) { return f.mKey == key; });
+
+  return frame == mFrames.end() ? 0 : frame->mResolutionLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRing::insert(
+    Timestep const& key, std::shared_ptr<VistaTexture> texture, int resolutionLevel) {
+  auto frame = std::find_if(
+      mFrames.begin(), mFrames.end(), [&key](Frame const& f) { return f.mKey == key; });
+
+  if (frame != mFrames.end()) {
+    frame->mTexture         = std::move(texture);
+    frame->mResolutionLevel = resolutionLevel;
+    frame->mLastUsed        = ++mUsageCounter;
+    return;
+  }
+
+  mFrames.push_back({key, std::move(texture), resolutionLevel, ++mUsageCounter});
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRing::setPinned(std::vector<Timestep> keys) {
+  mPinned = std::move(keys);
+  evict();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRing::clear() {
+  mFrames.clear();
+  mPinned.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRing::evict() {
+  while (mFrames.size() > mCapacity) {
+    auto oldest = mFrames.end();
+
+    for (auto frame = mFrames.begin(); frame != mFrames.end(); ++frame) {
+      bool pinned = std::find(mPinned.begin(), mPinned.end(), frame->mKey) != mPinned.end();
+      if (!pinned && (oldest == mFrames.end() || frame->mLastUsed < oldest->mLastUsed)) {
+        oldest = frame;
+      }
+    }
+
+    // All frames are pinned.
+    if (oldest == mFrames.end()) {
+      return;
+    }
+
+    mFrames.erase(oldest);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TEXTURE_RING_HPP
+#define CSP_WMS_TEXTURE_RING_HPP
+
+#include "TimeIndex.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class VistaTexture;
+
+namespace csp::simplewmsbodies {
+
+/// The TextureRing keeps the GPU textures of the last few timesteps of a time-series data set.
+/// When the simulation time advances by one step, the previous interpolation partner becomes the
+/// current texture; it is simply looked up here instead of being uploaded again. Thus, smooth
+/// playback needs a single upload per timestep. Once the ring is full, the least recently used
+/// texture which is not pinned is dropped.
+class TextureRing {
+ public:
+  /// The capacity is the number of textures kept on the GPU. It should be at least two.
+  explicit TextureRing(size_t capacity);
+
+  void setCapacity(size_t capacity);
+
+  /// Returns the texture for the given timestep and marks it as recently used. Returns nullptr if
+  /// the timestep is not in the ring.
+  std::shared_ptr<VistaTexture> get(Timestep const& key);
+
+  /// Returns true if the ring contains a texture for the given timestep.
+  bool contains(Timestep const& key) const;
+
+  /// Returns how often the configured resolution of the data set was halved for the texture of the
+  /// given timestep. Returns zero if the timestep is not in the ring.
+  int getResolutionLevel(Timestep const& key) const;
+
+  /// Stores an uploaded texture. If the ring is full, the least recently used unpinned texture is
+  /// removed.
+  void insert(Timestep const& key, std::shared_ptr<VistaTexture> texture, int resolutionLevel);
+
+  /// The textures with the given keys will not be removed until setPinned() is called again.
+  void setPinned(std::vector<Timestep> keys);
+
+  /// Removes all textures and pins.
+  void clear();
+
+ private:
+  struct Frame {
+    Timestep                      mKey;
+    std::shared_ptr<VistaTexture> mTexture;
+    int                           mResolutionLevel = 0;
+    uint64_t                      mLastUsed        = 0;
+  };
+
+  void evict();
+
+  std::vector<Frame>    mFrames;
+  std::vector<Timestep> mPinned;
+  size_t                mCapacity;
+  uint64_t              mUsageCounter = 0;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_TEXTURE_RING_HPP
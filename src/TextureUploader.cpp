@@ -0,0 +1,378 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TextureUploader.hpp"
+
+#include "../../../src/cs-utils/logger.hpp"
+#include "logger.hpp"
+
+#include <VistaOGLExt/VistaTexture.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Copy tasks are executed before decoding new textures, as the uploads are needed right now.
+const int COPY_PRIORITY = 1 << 20;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureUploader::TextureUploader(std::shared_ptr<WebMapTextureLoader> textureLoader)
+    : mTextureLoader(std::move(textureLoader)) {
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureUploader::~TextureUploader() {
+  // The workers may still write to the mapped buffers.
+  for (auto& upload : mUploads) {
+    if (upload.mCopy.valid()) {
+      upload.mCopy.wait();
+    }
+    if (upload.mFence) {
+      glDeleteSync(upload.mFence);
+    }
+  }
+
+  for (auto& buffer : mBuffers) {
+    if (buffer.mData) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.mBuffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glDeleteBuffers(1, &buffer.mBuffer);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureUploader::upload(Timestep const& key, DecodedTexture texture, int skippedLevels) {
+  skippedLevels = std::clamp(skippedLevels, 0, texture.getLevelCount() - 1);
+
+  for (auto& existing : mUploads) {
+    if (existing.mKey == key) {
+      // A cancelled upload stops transferring and is fenced right away. Once this has happened, it
+      // may be incomplete and cannot be resumed anymore, so it is left to finish on its own.
+      bool resumable = existing.mState == Upload::State::eCopying ||
+                       existing.mState == Upload::State::eTransferring;
+
+      if (existing.mSkippedLevels == skippedLevels && (!existing.mCancelled || resumable)) {
+        existing.mCancelled = false;
+        return;
+      }
+      existing.mCancelled = true;
+    }
+  }
+
+  size_t size = 0;
+  for (int level = skippedLevels; level < texture.getLevelCount(); ++level) {
+    size += texture.getLevelSize(level);
+  }
+
+  Buffer* buffer = acquireBuffer(size);
+  if (!buffer) {
+    return;
+  }
+
+  Upload& upload        = mUploads.emplace_back();
+  upload.mKey           = key;
+  upload.mSource        = std::move(texture);
+  upload.mBuffer        = buffer;
+  upload.mSkippedLevels = skippedLevels;
+  upload.mLevel         = skippedLevels;
+
+  // The source is captured by value, so that it stays alive even if it is evicted from the
+  // texture cache in the meantime. All levels are stored one after another.
+  upload.mCopy = mTextureLoader->processAsync(
+      [data = static_cast<unsigned char*>(buffer->mData), source = upload.mSource,
+          skippedLevels]() {
+        size_t offset = 0;
+        for (int level = skippedLevels; level < source.getLevelCount(); ++level) {
+          std::memcpy(data + offset, source.getLevelData(level), source.getLevelSize(level));
+          offset += source.getLevelSize(level);
+        }
+      },
+      std::make_shared<PriorityThreadPool::TaskHandle>(COPY_PRIORITY));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureUploader::isPending(Timestep const& key) const {
+  return std::any_of(mUploads.begin(), mUploads.end(), [&key](Upload const& u) {
+    return u.mKey == key && !u.mCancelled && u.mState != Upload::State::eDone;
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureUploader::Result TextureUploader::take(Timestep const& key) {
+  auto upload = std::find_if(mUploads.begin(), mUploads.end(), [&key](Upload const& u) {
+    return u.mKey == key && !u.mCancelled && u.mState == Upload::State::eDone;
+  });
+
+  if (upload == mUploads.end()) {
+    return {};
+  }
+
+  Result result{std::move(upload->mTexture), upload->mSkippedLevels,
+      upload->mSource.getLevelWidth(upload->mSkippedLevels)};
+  mUploads.erase(upload);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureUploader::retain(std::vector<Timestep> const& keys) {
+  for (auto& upload : mUploads) {
+    if (std::find(keys.begin(), keys.end(), upload.mKey) == keys.end()) {
+      upload.mCancelled = true;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureUploader::update(size_t maxBytes) {
+  auto upload = mUploads.begin();
+  while (upload != mUploads.end()) {
+    if (advance(*upload, maxBytes)) {
+      ++upload;
+    } else {
+      upload = mUploads.erase(upload);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<VistaTexture> TextureUploader::uploadNow(DecodedTexture const& texture) {
+  return createTexture(texture, 0, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<VistaTexture> TextureUploader::createTexture(
+    DecodedTexture const& source, int firstLevel, bool withData) {
+  int  lastLevel = source.getLevelCount() - 1;
+  bool mipmapped = lastLevel > firstLevel || withData;
+
+  auto texture = std::make_shared<VistaTexture>(GL_TEXTURE_2D);
+  texture->Bind();
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  for (int level = firstLevel; level <= lastLevel; ++level) {
+    glTexImage2D(GL_TEXTURE_2D, level - firstLevel, GL_RGBA8, source.getLevelWidth(level),
+        source.getLevelHeight(level), 0, GL_RGBA, GL_UNSIGNED_BYTE,
+        withData ? source.getLevelData(level) : nullptr);
+  }
+
+  // Textures which are uploaded at once get a mip chain even if none has been generated.
+  if (withData && lastLevel == firstLevel) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel - firstLevel);
+  }
+
+  glTexParameteri(
+      GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  if (mipmapped && GLEW_EXT_texture_filter_anisotropic) {
+    GLfloat maxAnisotropy = 1.f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
+  }
+  texture->Unbind();
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureUploader::advance(Upload& upload, size_t& remainingBytes) {
+  if (upload.mState == Upload::State::eCopying) {
+    if (upload.mCopy.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return true;
+    }
+
+    upload.mCopy.get();
+
+    // Buffers which are not persistently mapped have to be unmapped before the GL may read them.
+    if (!upload.mBuffer->mPersistent) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.mBuffer->mBuffer);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      upload.mBuffer->mData = nullptr;
+    }
+
+    if (upload.mCancelled) {
+      releaseBuffer(upload.mBuffer);
+      return false;
+    }
+
+    // Allocate the storage of all levels of the new texture. The pixels are transferred in the
+    // following frames. The first level which is not skipped becomes level 0 of the texture.
+    upload.mTexture = createTexture(upload.mSource, upload.mSkippedLevels, false);
+
+    upload.mState = Upload::State::eTransferring;
+  }
+
+  if (upload.mState == Upload::State::eTransferring) {
+    // The levels are transferred one after another. At least one row is transferred each frame,
+    // so that every upload finishes eventually.
+    bool first = true;
+
+    while (!upload.mCancelled && upload.mLevel < upload.mSource.getLevelCount() &&
+           (first || remainingBytes > 0)) {
+      int    width   = upload.mSource.getLevelWidth(upload.mLevel);
+      int    height  = upload.mSource.getLevelHeight(upload.mLevel);
+      size_t rowSize = static_cast<size_t>(width) * 4;
+      int    rows    = std::min(height - upload.mRowsTransferred,
+          std::max(1, static_cast<int>(remainingBytes / rowSize)));
+
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload.mBuffer->mBuffer);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      upload.mTexture->Bind();
+      glTexSubImage2D(GL_TEXTURE_2D, upload.mLevel - upload.mSkippedLevels, 0,
+          upload.mRowsTransferred, width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+          reinterpret_cast<void*>(
+              upload.mLevelOffset + static_cast<size_t>(upload.mRowsTransferred) * rowSize));
+      upload.mTexture->Unbind();
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+      upload.mRowsTransferred += rows;
+      remainingBytes -= std::min(remainingBytes, static_cast<size_t>(rows) * rowSize);
+      first = false;
+
+      if (upload.mRowsTransferred == height) {
+        upload.mLevelOffset += upload.mSource.getLevelSize(upload.mLevel);
+        upload.mRowsTransferred = 0;
+        ++upload.mLevel;
+      }
+    }
+
+    // The buffer may only be reused once the GL has finished reading from it.
+    if (upload.mCancelled || upload.mLevel == upload.mSource.getLevelCount()) {
+      upload.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      upload.mState = Upload::State::eFencing;
+    }
+
+    return true;
+  }
+
+  if (upload.mState == Upload::State::eFencing) {
+    GLenum result = glClientWaitSync(upload.mFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+      return true;
+    }
+
+    glDeleteSync(upload.mFence);
+    upload.mFence = nullptr;
+    releaseBuffer(upload.mBuffer);
+    upload.mBuffer = nullptr;
+
+    // The fence will never be signaled, so the texture is dropped. It will be requested again.
+    if (result == GL_WAIT_FAILED) {
+      logger().error("Failed to wait for the upload of a WMS texture (error {})!", glGetError());
+      return false;
+    }
+
+    // The pixels are not needed anymore, but the size is reported by take().
+    upload.mSource.mData.reset();
+    upload.mSource.mMipmaps.clear();
+
+    if (upload.mCancelled) {
+      return false;
+    }
+
+    upload.mState = Upload::State::eDone;
+  }
+
+  // Finished uploads are kept until they are taken, cancelled ones are dropped.
+  return !upload.mCancelled;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureUploader::Buffer* TextureUploader::acquireBuffer(size_t size) {
+  if (size == 0) {
+    return nullptr;
+  }
+
+  // Use the smallest free buffer which is large enough.
+  Buffer* buffer = nullptr;
+  for (auto& b : mBuffers) {
+    if (!b.mInUse && b.mSize >= size && (!buffer || b.mSize < buffer->mSize)) {
+      buffer = &b;
+    }
+  }
+
+  if (!buffer) {
+    // Free buffers which are too small are replaced by a larger one.
+    auto unused = std::find_if(mBuffers.begin(), mBuffers.end(), [](Buffer const& b) {
+      return !b.mInUse;
+    });
+    if (unused != mBuffers.end()) {
+      if (unused->mData) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unused->mBuffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      }
+      glDeleteBuffers(1, &unused->mBuffer);
+      mBuffers.erase(unused);
+    }
+
+    buffer              = &mBuffers.emplace_back();
+    buffer->mSize       = size;
+    buffer->mPersistent = GLEW_ARB_buffer_storage;
+
+    glGenBuffers(1, &buffer->mBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->mBuffer);
+
+    if (buffer->mPersistent) {
+      GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glBufferStorage(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, flags);
+      buffer->mData =
+          glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), flags);
+    } else {
+      glBufferData(
+          GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  // Buffers without persistent mapping are mapped for each upload. Invalidating them lets the
+  // driver hand out fresh memory instead of synchronizing.
+  if (!buffer->mPersistent) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->mBuffer);
+    buffer->mData = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+        static_cast<GLsizeiptr>(buffer->mSize), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  if (!buffer->mData) {
+    return nullptr;
+  }
+
+  buffer->mInUse = true;
+  return buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureUploader::releaseBuffer(Buffer* buffer) {
+  buffer->mInUse = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
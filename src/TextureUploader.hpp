@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TEXTURE_UPLOADER_HPP
+#define CSP_WMS_TEXTURE_UPLOADER_HPP
+
+#include "TimeIndex.hpp"
+#include "WebMapTextureLoader.hpp"
+
+#include <GL/glew.h>
+
+#include <future>
+#include <list>
+#include <memory>
+#include <vector>
+
+class VistaTexture;
+
+namespace csp::simplewmsbodies {
+
+/// The TextureUploader streams decoded textures to the GPU without stalling the render thread.
+/// The pixels are copied into a pixel buffer object by a worker of the WebMapTextureLoader. The
+/// transfer from the buffer to a new texture is then split into chunks of rows which are issued
+/// over several frames. Once the last chunk has been transferred, a fence is inserted; the texture
+/// is handed out only after the fence has signalled. If available, the pixel buffer objects are
+/// persistently mapped.
+/// If the decoded texture contains mipmaps, they are uploaded as well, one level after the other.
+/// The largest levels can be skipped if the texture is small on screen anyways.
+/// All methods have to be called from the render thread.
+class TextureUploader {
+ public:
+  explicit TextureUploader(std::shared_ptr<WebMapTextureLoader> textureLoader);
+
+  TextureUploader(TextureUploader const& other) = delete;
+  TextureUploader(TextureUploader&& other)      = delete;
+
+  TextureUploader& operator=(TextureUploader const& other) = delete;
+  TextureUploader& operator=(TextureUploader&& other) = delete;
+
+  ~TextureUploader();
+
+  /// A finished upload.
+  struct Result {
+    std::shared_ptr<VistaTexture> mTexture;           ///< nullptr if the upload is not finished.
+    int                           mSkippedLevels = 0; ///< Mip levels which were not uploaded.
+    int                           mWidth         = 0; ///< The width of the uploaded level 0.
+  };
+
+  /// Starts uploading the given texture without its skippedLevels largest mip levels. If there is
+  /// already an upload for the given key with the same amount of skipped levels, nothing happens.
+  /// Otherwise, the previous upload is cancelled.
+  void upload(Timestep const& key, DecodedTexture texture, int skippedLevels = 0);
+
+  /// Returns true if there is an unfinished upload for the given key.
+  bool isPending(Timestep const& key) const;
+
+  /// Returns the uploaded texture for the given key if its upload is complete and removes it from
+  /// the uploader. The texture of the result is nullptr otherwise.
+  Result take(Timestep const& key);
+
+  /// Cancels all uploads whose keys are not contained in the given list.
+  void retain(std::vector<Timestep> const& keys);
+
+  /// Uploads the given texture with all its levels synchronously and returns it. If it has no mip
+  /// chain, the chain is generated by the GL. This stalls the render thread and is only meant for
+  /// textures which are needed right away, such as the background textures during startup.
+  static std::shared_ptr<VistaTexture> uploadNow(DecodedTexture const& texture);
+
+  /// Advances all uploads. At most maxBytes are transferred to the GPU in this call. This should
+  /// be called once each frame.
+  void update(size_t maxBytes);
+
+ private:
+  struct Buffer {
+    GLuint mBuffer     = 0;
+    size_t mSize       = 0;
+    void*  mData       = nullptr;
+    bool   mPersistent = false;
+    bool   mInUse      = false;
+  };
+
+  struct Upload {
+    enum class State { eCopying, eTransferring, eFencing, eDone };
+
+    Timestep                      mKey;
+    DecodedTexture                mSource;
+    Buffer*                       mBuffer = nullptr;
+    std::future<void>             mCopy;
+    int                           mSkippedLevels   = 0;
+    int                           mLevel           = 0; ///< The level which is transferred.
+    size_t                        mLevelOffset     = 0; ///< Its offset in the buffer.
+    int                           mRowsTransferred = 0; ///< The finished rows of this level.
+    GLsync                        mFence           = nullptr;
+    std::shared_ptr<VistaTexture> mTexture;
+    State                         mState     = State::eCopying;
+    bool                          mCancelled = false;
+  };
+
+  /// Returns an unused buffer which is large enough for the given amount of bytes and maps it.
+  Buffer* acquireBuffer(size_t size);
+  void    releaseBuffer(Buffer* buffer);
+
+  /// Creates a texture with the levels of the source starting at firstLevel and sets up its
+  /// filtering. If withData is set, the pixels are uploaded as well.
+  static std::shared_ptr<VistaTexture> createTexture(
+      DecodedTexture const& source, int firstLevel, bool withData);
+
+  /// Returns false if the upload is finished or cancelled and can be removed.
+  bool advance(Upload& upload, size_t& remainingBytes);
+
+  std::shared_ptr<WebMapTextureLoader> mTextureLoader;
+  std::list<Buffer>                    mBuffers;
+  std::list<Upload>                    mUploads;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_TEXTURE_UPLOADER_HPP
@@ -0,0 +1,408 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TileStreamer.hpp"
+
+#include "logger.hpp"
+
+#include <VistaOGLExt/VistaTexture.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const int TileStreamer::MAX_LEVEL   = 8;
+const int TileStreamer::ATLAS_SLOTS = 16;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const double PI = 3.141592654;
+
+// Returns the position on the surface for the given texture coordinates. This matches the
+// vertex shader of the SimpleWMSBody.
+glm::dvec3 toCartesian(double u, double v, glm::dvec3 const& radii) {
+  double lon = u * 2.0 * PI;
+  double lat = (0.5 - v) * PI;
+  return radii * glm::dvec3(-std::sin(lon) * std::cos(lat), std::sin(lat),
+                     -std::cos(lon) * std::cos(lat));
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileStreamer::TileId::operator<(TileId const& other) const {
+  // Coarse tiles come first, so that iterating over a set of tiles loads them first.
+  if (mLevel != other.mLevel) {
+    return mLevel < other.mLevel;
+  }
+  if (mY != other.mY) {
+    return mY < other.mY;
+  }
+  return mX < other.mX;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileStreamer::TileId::operator==(TileId const& other) const {
+  return mLevel == other.mLevel && mX == other.mX && mY == other.mY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileStreamer::TileId TileStreamer::TileId::getParent() const {
+  return {mLevel - 1, mX / 2, mY / 2};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileStreamer::TileStreamer(std::shared_ptr<WebMapTextureLoader> textureLoader,
+    std::string request, std::string layers, int tileSize, int maxLevel)
+    : mTextureLoader(std::move(textureLoader))
+    , mRequest(std::move(request))
+    , mLayers(std::move(layers))
+    , mTileSize(std::max(tileSize, 1))
+    , mMaxLevel(std::clamp(maxLevel, 0, MAX_LEVEL)) {
+
+  if (maxLevel > MAX_LEVEL) {
+    logger().warn("Maximum tile level {} is not supported, using {} instead.", maxLevel, MAX_LEVEL);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileStreamer::~TileStreamer() {
+  // The texture loader is shared with other bodies, so we have to cancel our requests explicitly.
+  for (auto const& request : mRequests) {
+    request.second.mHandle->cancel();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::update(std::string const& time, glm::dvec3 const& observer,
+    glm::dvec3 const& radii, double pixelScale, int priority, std::string const& mapCache,
+    size_t maxBytes) {
+
+  ++mFrame;
+
+  // The GL resources are created lazily, as this has to happen on the render thread.
+  if (!mAtlas) {
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    mAtlasSlots = std::clamp(maxSize / mTileSize, 1, ATLAS_SLOTS);
+    mSlots.resize(static_cast<size_t>(mAtlasSlots * mAtlasSlots));
+
+    mAtlas = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+    mAtlas->Bind();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, mAtlasSlots * mTileSize, mAtlasSlots * mTileSize, 0,
+        GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    mAtlas->Unbind();
+
+    // Integer textures cannot be filtered.
+    mIndex = std::make_unique<VistaTexture>(GL_TEXTURE_2D);
+    mIndex->Bind();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8UI, 2 << mMaxLevel, 1 << mMaxLevel, 0,
+        GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mIndex->Unbind();
+
+    mIndexData.resize(static_cast<size_t>(2 << mMaxLevel) * (1 << mMaxLevel) * 4);
+  }
+
+  // Tiles of the previous timestep are shown until they are replaced.
+  if (time != mTime) {
+    mTime = time;
+    mFailedTiles.clear();
+  }
+
+  std::vector<TileId> leaves;
+  selectTiles({0, 0, 0}, observer, radii, pixelScale, leaves);
+  selectTiles({0, 1, 0}, observer, radii, pixelScale, leaves);
+
+  if (leaves != mLeaves) {
+    mLeaves     = std::move(leaves);
+    mIndexDirty = true;
+  }
+
+  // The tiles of level 0 are always loaded, so that there is something to fall back to.
+  std::set<TileId> neededTiles(mLeaves.begin(), mLeaves.end());
+  neededTiles.insert({0, 0, 0});
+  neededTiles.insert({0, 1, 0});
+
+  // Cancel requests which are not needed anymore.
+  auto request = mRequests.begin();
+  while (request != mRequests.end()) {
+    if (request->second.mTime != mTime || neededTiles.count(request->first) == 0) {
+      request->second.mHandle->cancel();
+      request = mRequests.erase(request);
+    } else {
+      ++request;
+    }
+  }
+
+  // Move finished tiles to the atlas.
+  size_t tileBytes     = static_cast<size_t>(mTileSize) * mTileSize * 4;
+  size_t uploadedBytes = 0;
+
+  request = mRequests.begin();
+  while (request != mRequests.end()) {
+    // At least one tile is uploaded per frame.
+    if (uploadedBytes > 0 && uploadedBytes + tileBytes > maxBytes) {
+      break;
+    }
+
+    Request& pending = request->second;
+
+    if (pending.mTexture.valid()) {
+      if (pending.mTexture.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        ++request;
+        continue;
+      }
+
+      pending.mDecoded = pending.mTexture.get();
+    }
+
+    DecodedTexture const& texture = pending.mDecoded;
+    TileId                tile    = request->first;
+
+    if (!texture.mData || texture.mWidth != mTileSize || texture.mHeight != mTileSize) {
+      if (texture.mData) {
+        logger().warn("Received a tile with {}x{} pixels, expected {}x{}!", texture.mWidth,
+            texture.mHeight, mTileSize, mTileSize);
+      }
+      mFailedTiles.insert(tile);
+    } else {
+      auto resident = mResidentTiles.find(tile);
+      int  slot = resident != mResidentTiles.end() ? resident->second : acquireSlot(neededTiles);
+
+      // If all slots are needed for the current view, the tile is kept until one becomes free.
+      // Dropping it would request it again in the next frame.
+      if (slot < 0) {
+        ++request;
+        continue;
+      }
+
+      uploadTile(slot, texture);
+      mSlots[slot]         = {tile, mTime, mFrame, true};
+      mResidentTiles[tile] = slot;
+      mIndexDirty          = true;
+      uploadedBytes += tileBytes;
+    }
+
+    request = mRequests.erase(request);
+  }
+
+  // Request missing tiles, coarse ones first.
+  for (auto const& tile : neededTiles) {
+    auto resident = mResidentTiles.find(tile);
+    if (resident != mResidentTiles.end()) {
+      mSlots[resident->second].mLastUsed = mFrame;
+
+      if (mSlots[resident->second].mTime == mTime) {
+        continue;
+      }
+    }
+
+    int  tilePriority = priority - tile.mLevel;
+    auto pending      = mRequests.find(tile);
+
+    if (pending != mRequests.end()) {
+      pending->second.mHandle->setPriority(tilePriority);
+    } else if (mFailedTiles.count(tile) == 0) {
+      double width  = 360.0 / (2 << tile.mLevel);
+      double height = 180.0 / (1 << tile.mLevel);
+
+      std::stringstream url;
+      url << mRequest << "&WIDTH=" << mTileSize << "&HEIGHT=" << mTileSize
+          << "&BBOX=" << -180.0 + tile.mX * width << "," << 90.0 - (tile.mY + 1) * height << ","
+          << -180.0 + (tile.mX + 1) * width << "," << 90.0 - tile.mY * height;
+
+      // Each tile gets its own directory in the map cache. Tiles of different sizes are stored
+      // separately, so that changing the tile size does not load tiles of the wrong size.
+      std::string layer = mLayers + "/tiles/" + std::to_string(mTileSize) + "x" +
+                          std::to_string(mTileSize) + "/" + std::to_string(tile.mLevel) + "/" +
+                          std::to_string(tile.mX) + "_" + std::to_string(tile.mY);
+
+      // The atlas has no mipmaps, so none are generated for the tiles.
+      auto handle = std::make_shared<PriorityThreadPool::TaskHandle>(tilePriority);
+      auto texture =
+          mTextureLoader->loadTextureAsync(mTime, url.str(), layer, mapCache, handle, false);
+      mRequests.emplace(tile, Request{mTime, handle, std::move(texture), {}});
+    }
+  }
+
+  if (mIndexDirty) {
+    updateIndex();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileStreamer::isReady() const {
+  return !mResidentTiles.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::bind(GLenum atlasUnit, GLenum indexUnit) {
+  mAtlas->Bind(atlasUnit);
+  mIndex->Bind(indexUnit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::unbind(GLenum atlasUnit, GLenum indexUnit) {
+  mAtlas->Unbind(atlasUnit);
+  mIndex->Unbind(indexUnit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileStreamer::getTileSize() const {
+  return mTileSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileStreamer::getAtlasSlots() const {
+  return mAtlasSlots;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::selectTiles(TileId const& tile, glm::dvec3 const& observer,
+    glm::dvec3 const& radii, double pixelScale, std::vector<TileId>& leaves) const {
+
+  double tilesX = 2 << tile.mLevel;
+  double tilesY = 1 << tile.mLevel;
+
+  // Estimate the size of the tile on screen. The width is measured at the latitude which is
+  // closest to the equator.
+  double u      = (tile.mX + 0.5) / tilesX;
+  double v0     = tile.mY / tilesY;
+  double v1     = (tile.mY + 1) / tilesY;
+  double minLat = (v0 < 0.5 && v1 > 0.5) ? 0.0 : std::min(std::abs(0.5 - v0), std::abs(0.5 - v1));
+
+  double     radius = std::max(radii[0], std::max(radii[1], radii[2]));
+  double     width  = 2.0 * PI * radius * std::cos(minLat * PI) / tilesX;
+  double     height = PI * radius / tilesY;
+  double     size   = std::max(width, height);
+  glm::dvec3 center = toCartesian(u, 0.5 * (v0 + v1), radii);
+
+  double distance  = std::max(glm::length(observer - center) - 0.5 * size, 0.01 * size);
+  double projected = size / distance * pixelScale;
+
+  // Tiles on the far side of the body are not refined. The first levels are too large for this
+  // test.
+  bool facingAway = tile.mLevel >= 2 &&
+                    glm::dot(glm::normalize(center), glm::normalize(observer - center)) < -0.25;
+
+  if (tile.mLevel < mMaxLevel && projected > mTileSize && !facingAway) {
+    for (int y = 0; y < 2; ++y) {
+      for (int x = 0; x < 2; ++x) {
+        selectTiles({tile.mLevel + 1, tile.mX * 2 + x, tile.mY * 2 + y}, observer, radii,
+            pixelScale, leaves);
+      }
+    }
+  } else {
+    leaves.push_back(tile);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TileStreamer::acquireSlot(std::set<TileId> const& neededTiles) {
+  int oldest = -1;
+
+  for (size_t i = 0; i < mSlots.size(); ++i) {
+    auto const& slot = mSlots[i];
+
+    if (!slot.mUsed) {
+      return static_cast<int>(i);
+    }
+
+    // Slots which were used in this frame may serve as fallback for other tiles.
+    if (slot.mLastUsed != mFrame && neededTiles.count(slot.mTile) == 0 &&
+        (oldest < 0 || slot.mLastUsed < mSlots[oldest].mLastUsed)) {
+      oldest = static_cast<int>(i);
+    }
+  }
+
+  if (oldest >= 0) {
+    mResidentTiles.erase(mSlots[oldest].mTile);
+    mSlots[oldest].mUsed = false;
+    mIndexDirty          = true;
+  }
+
+  return oldest;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::uploadTile(int slot, DecodedTexture const& texture) {
+  mAtlas->Bind();
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % mAtlasSlots) * mTileSize,
+      (slot / mAtlasSlots) * mTileSize, mTileSize, mTileSize, GL_RGBA, GL_UNSIGNED_BYTE,
+      texture.mData.get());
+  mAtlas->Unbind();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TileStreamer::updateIndex() {
+  int indexWidth = 2 << mMaxLevel;
+
+  // Each leaf covers a square of texels in the index. If it is not loaded yet, its closest loaded
+  // ancestor is used.
+  for (auto const& leaf : mLeaves) {
+    TileId tile     = leaf;
+    auto   resident = mResidentTiles.find(tile);
+    while (resident == mResidentTiles.end() && tile.mLevel > 0) {
+      tile     = tile.getParent();
+      resident = mResidentTiles.find(tile);
+    }
+
+    uint8_t entry[4] = {0, 0, 0, 0};
+    if (resident != mResidentTiles.end()) {
+      mSlots[resident->second].mLastUsed = mFrame;
+
+      entry[0] = static_cast<uint8_t>(resident->second % mAtlasSlots);
+      entry[1] = static_cast<uint8_t>(resident->second / mAtlasSlots);
+      entry[2] = static_cast<uint8_t>(tile.mLevel);
+      entry[3] = 255;
+    }
+
+    int scale = 1 << (mMaxLevel - leaf.mLevel);
+    for (int y = leaf.mY * scale; y < (leaf.mY + 1) * scale; ++y) {
+      for (int x = leaf.mX * scale; x < (leaf.mX + 1) * scale; ++x) {
+        std::copy(entry, entry + 4, &mIndexData[(static_cast<size_t>(y) * indexWidth + x) * 4]);
+      }
+    }
+  }
+
+  mIndex->Bind();
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, indexWidth, 1 << mMaxLevel, GL_RGBA_INTEGER,
+      GL_UNSIGNED_BYTE, mIndexData.data());
+  mIndex->Unbind();
+
+  mIndexDirty = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TILE_STREAMER_HPP
+#define CSP_WMS_TILE_STREAMER_HPP
+
+#include "WebMapTextureLoader.hpp"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class VistaTexture;
+
+namespace csp::simplewmsbodies {
+
+/// The TileStreamer loads a WMS data set as a quadtree of tiles instead of one global image. On
+/// level 0, two tiles cover the western and the eastern hemisphere; each tile is split into four
+/// children on the next level. Each frame, the quadtree is refined until the tiles are about as
+/// large on screen as they have pixels. Only these tiles are requested from the map server by
+/// adding a BBOX parameter to the request.
+/// Loaded tiles are stored in the slots of a texture atlas. An index texture with one texel per
+/// tile of the finest level stores which slot should be used for each part of the surface. If a
+/// tile is not loaded yet, the slot of its closest loaded ancestor is used instead.
+/// All methods have to be called from the render thread.
+class TileStreamer {
+ public:
+  /// The maximum supported quadtree level. The index texture of this level has 512x256 texels.
+  static const int MAX_LEVEL;
+
+  /// The maximum width and height of the atlas in slots. Less slots are used if the atlas would
+  /// exceed the maximum texture size.
+  static const int ATLAS_SLOTS;
+
+  /// Identifies a tile of the quadtree. On level L there are 2^(L+1) x 2^L tiles; x grows to the
+  /// east, y grows to the south.
+  struct TileId {
+    int mLevel = 0;
+    int mX     = 0;
+    int mY     = 0;
+
+    bool operator<(TileId const& other) const;
+    bool operator==(TileId const& other) const;
+
+    TileId getParent() const;
+  };
+
+  /// The request should contain the map server URL and the LAYERS parameter, but neither WIDTH,
+  /// HEIGHT nor BBOX.
+  TileStreamer(std::shared_ptr<WebMapTextureLoader> textureLoader, std::string request,
+      std::string layers, int tileSize, int maxLevel);
+
+  TileStreamer(TileStreamer const& other) = delete;
+  TileStreamer(TileStreamer&& other)      = delete;
+
+  TileStreamer& operator=(TileStreamer const& other) = delete;
+  TileStreamer& operator=(TileStreamer&& other) = delete;
+
+  ~TileStreamer();
+
+  /// Selects the tiles for the current view, requests missing ones and uploads finished tiles to
+  /// the atlas. The observer position has to be given in the coordinate system of the body.
+  /// pixelScale is the size in pixels of an object with a size of one at a distance of one.
+  /// time may be empty for data sets without time. At most maxBytes are uploaded to the atlas.
+  void update(std::string const& time, glm::dvec3 const& observer, glm::dvec3 const& radii,
+      double pixelScale, int priority, std::string const& mapCache, size_t maxBytes);
+
+  /// Returns true if at least one tile is available for rendering.
+  bool isReady() const;
+
+  /// Binds the atlas and the index texture to the given texture units.
+  void bind(GLenum atlasUnit, GLenum indexUnit);
+  void unbind(GLenum atlasUnit, GLenum indexUnit);
+
+  int getTileSize() const;
+
+  /// Returns the width and height of the atlas in slots.
+  int getAtlasSlots() const;
+
+ private:
+  struct Slot {
+    TileId      mTile;
+    std::string mTime;
+    uint64_t    mLastUsed = 0;
+    bool        mUsed     = false;
+  };
+
+  struct Request {
+    std::string                        mTime;
+    WebMapTextureLoader::RequestHandle mHandle;
+    std::future<DecodedTexture>        mTexture;
+    DecodedTexture                     mDecoded; ///< Kept if there was no free slot for it.
+  };
+
+  /// Recursively selects the leaves of the quadtree for the current view.
+  void selectTiles(TileId const& tile, glm::dvec3 const& observer, glm::dvec3 const& radii,
+      double pixelScale, std::vector<TileId>& leaves) const;
+
+  /// Returns the index of a slot which is not needed for the current view or -1 if all slots are
+  /// in use.
+  int acquireSlot(std::set<TileId> const& neededTiles);
+
+  void uploadTile(int slot, DecodedTexture const& texture);
+  void updateIndex();
+
+  std::shared_ptr<WebMapTextureLoader> mTextureLoader;
+  std::string                          mRequest;
+  std::string                          mLayers;
+  int                                  mTileSize;
+  int                                  mMaxLevel;
+
+  int                           mAtlasSlots = 0;
+  std::unique_ptr<VistaTexture> mAtlas;
+  std::unique_ptr<VistaTexture> mIndex;
+  std::vector<uint8_t>          mIndexData;
+  bool                          mIndexDirty = true;
+
+  std::vector<Slot>         mSlots;
+  std::map<TileId, int>     mResidentTiles;
+  std::map<TileId, Request> mRequests;
+  std::set<TileId>          mFailedTiles;
+  std::vector<TileId>       mLeaves;
+  std::string               mTime;
+  uint64_t                  mFrame = 0;
+};
+
+} // namespace csp::simplewmsbodies
+
+#endif // CSP_WMS_TILE_STREAMER_HPP
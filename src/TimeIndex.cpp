@@ -0,0 +1,302 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "TimeIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+const boost::posix_time::ptime EPOCH(boost::gregorian::date(1970, 1, 1));
+
+// Returns the full seconds since the epoch, times before the epoch are rounded down as well.
+int64_t toSeconds(boost::posix_time::ptime const& time) {
+  int64_t ticks   = (time - EPOCH).ticks();
+  int64_t perSec  = boost::posix_time::time_duration::ticks_per_second();
+  int64_t seconds = ticks / perSec;
+  return ticks % perSec < 0 ? seconds - 1 : seconds;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TimeIndex::TimeIndex(std::vector<TimeInterval> const& intervals) {
+  std::vector<Interval> sorted;
+  sorted.reserve(intervals.size());
+
+  for (auto const& interval : intervals) {
+    int64_t start    = toSeconds(interval.mStartTime);
+    int64_t end      = std::max(toSeconds(interval.mEndTime), start);
+    int     duration = interval.mIntervalDuration;
+    int64_t lastStep = duration != 0 ? start + (end - start) / duration * duration : start;
+
+    sorted.push_back({start, lastStep, end + duration, duration, false, interval.mFormat});
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(),
+      [](Interval const& a, Interval const& b) { return a.mStart < b.mStart; });
+
+  mIntervals.reserve(sorted.size());
+
+  // Returns true if the given interval consists of a single point in time of the given format.
+  auto isLonePoint = [](Interval const& interval, std::string const& format) {
+    return interval.mDuration == 0 && interval.mEnd == interval.mStart &&
+           interval.mFormat == format;
+  };
+
+  for (auto& interval : sorted) {
+    if (!mIntervals.empty()) {
+      Interval& back = mIntervals.back();
+
+      if (isLonePoint(interval, interval.mFormat)) {
+        int64_t spacing = interval.mStart - back.mLastStep;
+
+        // A sequence of points is extended if the spacing does not change. This has to be checked
+        // first, as the next point is exactly at the end of the sequence.
+        if (back.mPoints && back.mFormat == interval.mFormat && spacing == back.mDuration) {
+          back.mLastStep = interval.mStart;
+          back.mEnd      = interval.mStart + back.mDuration;
+          continue;
+        }
+
+        // Points which are covered by the previous interval do not add anything.
+        if (interval.mStart <= back.mEnd) {
+          continue;
+        }
+
+        // Three equally spaced points become the first steps of a new sequence. Like the steps of
+        // any other interval, each point then covers the time until the next one. Two points are
+        // not enough, as they may be far apart without being part of a regular series.
+        size_t count = mIntervals.size();
+        if (count >= 2 && isLonePoint(back, interval.mFormat) &&
+            isLonePoint(mIntervals[count - 2], interval.mFormat) &&
+            back.mStart - mIntervals[count - 2].mStart == spacing &&
+            spacing <= std::numeric_limits<int>::max()) {
+          Interval& first = mIntervals[count - 2];
+          first.mDuration = static_cast<int>(spacing);
+          first.mLastStep = interval.mStart;
+          first.mEnd      = interval.mStart + spacing;
+          first.mPoints   = true;
+          mIntervals.pop_back();
+          continue;
+        }
+      } else if (interval.mDuration != 0 && !back.mPoints &&
+                 back.mDuration == interval.mDuration && back.mFormat == interval.mFormat &&
+                 interval.mStart <= back.mEnd &&
+                 (interval.mStart - back.mStart) % interval.mDuration == 0) {
+        // Intervals which overlap or touch are merged if their steps are aligned.
+        back.mLastStep = std::max(back.mLastStep, interval.mLastStep);
+        back.mEnd      = std::max(back.mEnd, interval.mEnd);
+        continue;
+      }
+    }
+
+    mIntervals.push_back(std::move(interval));
+  }
+
+  // Intervals which cannot be merged may still overlap. These values allow lookups to find an
+  // earlier interval which covers a time after the end of a later one.
+  for (size_t i = 0; i < mIntervals.size(); ++i) {
+    Interval& current = mIntervals[i];
+    current.mMaxEnd   = current.mEnd;
+    current.mLatest   = static_cast<int32_t>(i);
+
+    if (i > 0) {
+      Interval const& previous = mIntervals[i - 1];
+      current.mMaxEnd          = std::max(current.mMaxEnd, previous.mMaxEnd);
+
+      if (mIntervals[previous.mLatest].mLastStep > current.mLastStep) {
+        current.mLatest = previous.mLatest;
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TimeIndex::empty() const {
+  return mIntervals.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<Timestep> TimeIndex::find(boost::posix_time::ptime const& time) const {
+  return find(toSeconds(time));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<Timestep> TimeIndex::getPrevious(boost::posix_time::ptime const& time) const {
+  int64_t seconds = toSeconds(time);
+
+  if (auto timestep = find(seconds)) {
+    return timestep;
+  }
+
+  int32_t interval = findInterval(seconds);
+
+  if (interval < 0) {
+    return std::nullopt;
+  }
+
+  // In a gap, all intervals which start before the time have ended, so the last step which begins
+  // latest is returned.
+  int32_t latest = mIntervals[interval].mLatest;
+  return Timestep{latest, getLastStep(latest)};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<Timestep> TimeIndex::getNext(boost::posix_time::ptime const& time) const {
+  int64_t seconds  = toSeconds(time);
+  int32_t interval = findInterval(seconds);
+
+  std::optional<Timestep> result;
+  int64_t                 resultStart = 0;
+
+  if (interval + 1 < static_cast<int32_t>(mIntervals.size())) {
+    result      = Timestep{interval + 1, 0};
+    resultStart = mIntervals[interval + 1].mStart;
+  }
+
+  // The following step of any interval which has not ended yet may begin earlier. For equal start
+  // times, the interval which starts last is preferred.
+  for (int32_t i = interval; i >= 0 && mIntervals[i].mMaxEnd > seconds; --i) {
+    Interval const& current = mIntervals[i];
+
+    if (current.mDuration == 0) {
+      continue;
+    }
+
+    int64_t step  = (seconds - current.mStart) / current.mDuration + 1;
+    int64_t start = current.mStart + step * current.mDuration;
+
+    if (step <= getLastStep(i) && (!result || start < resultStart)) {
+      result      = Timestep{i, step};
+      resultStart = start;
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<Timestep> TimeIndex::offset(Timestep const& timestep, int64_t steps) const {
+  Timestep result = timestep;
+
+  // When the end of an interval is reached, the counting continues in the next one.
+  while (steps > 0) {
+    int64_t remaining = getLastStep(result.mInterval) - result.mStep;
+
+    if (steps <= remaining) {
+      result.mStep += steps;
+      return result;
+    }
+
+    if (result.mInterval + 1 >= static_cast<int32_t>(mIntervals.size())) {
+      return std::nullopt;
+    }
+
+    steps -= remaining + 1;
+    result = Timestep{result.mInterval + 1, 0};
+  }
+
+  while (steps < 0) {
+    if (-steps <= result.mStep) {
+      result.mStep += steps;
+      return result;
+    }
+
+    if (result.mInterval == 0) {
+      return std::nullopt;
+    }
+
+    steps += result.mStep + 1;
+    result = Timestep{result.mInterval - 1, getLastStep(result.mInterval - 1)};
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+boost::posix_time::ptime TimeIndex::getStartTime(Timestep const& timestep) const {
+  return EPOCH + boost::posix_time::seconds(getStartSeconds(timestep));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TimeIndex::getDuration(Timestep const& timestep) const {
+  return mIntervals[timestep.mInterval].mDuration;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string TimeIndex::format(Timestep const& timestep, bool timespan) const {
+  Interval const& interval = mIntervals[timestep.mInterval];
+  std::string     result   = utils::timeToString(interval.mFormat, getStartTime(timestep));
+
+  // The span ends where the following step of the interval begins.
+  if (timespan && interval.mDuration != 0 && !interval.mPoints) {
+    int64_t end = getStartSeconds(timestep) + interval.mDuration;
+    result += "/" + utils::timeToString(interval.mFormat, EPOCH + boost::posix_time::seconds(end));
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int32_t TimeIndex::findInterval(int64_t seconds) const {
+  auto it = std::upper_bound(mIntervals.begin(), mIntervals.end(), seconds,
+      [](int64_t value, Interval const& interval) { return value < interval.mStart; });
+
+  return static_cast<int32_t>(it - mIntervals.begin()) - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<Timestep> TimeIndex::find(int64_t seconds) const {
+  // Of all intervals which contain the given time, the one starting last is used. Earlier ones are
+  // only searched as long as any of them ends after the given time.
+  for (int32_t interval = findInterval(seconds);
+       interval >= 0 && mIntervals[interval].mMaxEnd >= seconds; --interval) {
+    Interval const& current = mIntervals[interval];
+
+    if (seconds > current.mEnd) {
+      continue;
+    }
+
+    // The last step also covers the time until the end of the interval.
+    int64_t step = current.mDuration != 0 ? (seconds - current.mStart) / current.mDuration : 0;
+    return Timestep{interval, std::min(step, getLastStep(interval))};
+  }
+
+  return std::nullopt;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int64_t TimeIndex::getStartSeconds(Timestep const& timestep) const {
+  Interval const& interval = mIntervals[timestep.mInterval];
+  return interval.mStart + timestep.mStep * interval.mDuration;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int64_t TimeIndex::getLastStep(int32_t interval) const {
+  Interval const& current = mIntervals[interval];
+  return current.mDuration != 0 ? (current.mLastStep - current.mStart) / current.mDuration : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
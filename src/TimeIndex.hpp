@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef CSP_WMS_TIME_INDEX_HPP
+#define CSP_WMS_TIME_INDEX_HPP
+
+#include "utils.hpp"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace csp::simplewmsbodies {
+
+/// Identifies a single timestep of a time-series data set by the interval it belongs to and the
+/// number of steps since the beginning of this interval.
+struct Timestep {
+  int32_t mInterval = -1; ///< Index of the interval in the TimeIndex.
+  int64_t mStep     = 0;  ///< Number of interval durations since the start of the interval.
+
+  bool operator==(Timestep const& other) const {
+    return mInterval == other.mInterval && mStep == other.mStep;
+  }
+
+  bool operator!=(Timestep const& other) const {
+    return !(*this == other);
+  }
+
+  bool operator<(Timestep const& other) const {
+    return mInterval < other.mInterval || (mInterval == other.mInterval && mStep < other.mStep);
+  }
+};
+
+/// The TimeIndex maps points in time to the timesteps of a data set. It is built once from the
+/// parsed time intervals; lookups are binary searches on integer seconds and do not allocate any
+/// memory. Timesteps are only converted to strings when a request for them is actually issued.
+///
+/// When the index is built, the intervals are sorted and adjacent intervals with the same step
+/// duration are merged. Lists of at least three single points in time with a constant spacing, as
+/// many servers publish them, become a single interval whose steps are these points. Like any
+/// other step, each of these points covers the time until the next one. Other points only cover
+/// their own second. Between two intervals there may be gaps; offset(), getPrevious() and
+/// getNext() skip them.
+class TimeIndex {
+ public:
+  TimeIndex() = default;
+
+  /// Where intervals overlap and cannot be merged, the one starting last is used. After its end,
+  /// the overlapping earlier interval applies again.
+  explicit TimeIndex(std::vector<TimeInterval> const& intervals);
+
+  /// Returns true if the index contains no intervals.
+  bool empty() const;
+
+  /// Returns the timestep which contains the given time or std::nullopt if the time is not inside
+  /// any interval. Fractions of seconds are ignored.
+  std::optional<Timestep> find(boost::posix_time::ptime const& time) const;
+
+  /// Returns the last timestep which begins at or before the given time, even if the time is in
+  /// a gap between two intervals. Returns std::nullopt if the time is before all intervals.
+  std::optional<Timestep> getPrevious(boost::posix_time::ptime const& time) const;
+
+  /// Returns the first timestep which begins after the given time. Returns std::nullopt if there
+  /// is none.
+  std::optional<Timestep> getNext(boost::posix_time::ptime const& time) const;
+
+  /// Returns the timestep which is the given number of steps away from the given one. Gaps
+  /// between intervals are skipped, so the result is always an available timestep. Returns
+  /// std::nullopt if there are not enough timesteps in the given direction.
+  std::optional<Timestep> offset(Timestep const& timestep, int64_t steps) const;
+
+  /// Returns the time at which the given timestep begins.
+  boost::posix_time::ptime getStartTime(Timestep const& timestep) const;
+
+  /// Returns the duration of the given timestep in seconds. This is zero for single points in time
+  /// which are not part of a sequence.
+  int getDuration(Timestep const& timestep) const;
+
+  /// Returns the string which is used to request the given timestep from the map server. If
+  /// timespan is set, the start of the following timestep is appended after a slash. This is not
+  /// done for timesteps which were given as single points in time.
+  std::string format(Timestep const& timestep, bool timespan) const;
+
+ private:
+  struct Interval {
+    int64_t     mStart;      ///< Seconds since the epoch.
+    int64_t     mLastStep;   ///< Start of the last step in seconds since the epoch.
+    int64_t     mEnd;        ///< Seconds since the epoch including the duration of the last step.
+    int         mDuration;   ///< Duration of each step in seconds.
+    bool        mPoints;     ///< Whether the steps were given as single points in time.
+    std::string mFormat;     ///< The format of time strings of this interval.
+    int64_t     mMaxEnd = 0; ///< The largest mEnd of this and all previous intervals.
+    int32_t     mLatest = 0; ///< The interval up to this one whose last step begins last.
+  };
+
+  /// Returns the index of the last interval which starts at or before the given time or -1. This
+  /// interval does not necessarily contain the time.
+  int32_t findInterval(int64_t seconds) const;
+
+  std::optional<Timestep> find(int64_t seconds) const;
+  int64_t                 getStartSeconds(Timestep const& timestep) const;
+  int64_t                 getLastStep(int32_t interval) const;
+
+  std::vector<Interval> mIntervals; ///< Sorted by start time.
+};
+
+} // namespace csp::simplewmsbodies
+
+namespace std {
+
+/// Timesteps are used as keys of the texture caches.
+template <>
+struct hash<csp::simplewmsbodies::Timestep> {
+  size_t operator()(csp::simplewmsbodies::Timestep const& timestep) const noexcept {
+    return hash<int64_t>()(timestep.mStep ^ (static_cast<int64_t>(timestep.mInterval) << 40));
+  }
+};
+
+} // namespace std
+
+#endif // CSP_WMS_TIME_INDEX_HPP
@@ -9,6 +9,7 @@
 #include "../../../src/cs-utils/convert.hpp"
 #include "../../../src/cs-utils/filesystem.hpp"
 #include "../../../src/cs-utils/logger.hpp"
+#include "RawTextureFile.hpp"
 #include "logger.hpp"
 
 #include <boost/algorithm/string.hpp>
@@ -21,30 +22,259 @@
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include <functional>
+#include <limits>
+#include <thread>
+
 namespace csp::simplewmsbodies {
 
+namespace {
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-WebMapTextureLoader::WebMapTextureLoader()
-    : mThreadPool(32) {
+/// Returns true if the end marker matching the file type given by the first four bytes is present
+/// in the last eight bytes. Only PNG and JPEG files have such markers, other types are always
+/// reported as complete.
+bool hasEndMarker(unsigned char const* head, unsigned char const* tail) {
+  // A PNG file ends with an IEND chunk followed by its four byte checksum.
+  if (head[0] == 0x89 && head[1] == 'P' && head[2] == 'N' && head[3] == 'G') {
+    return tail[0] == 'I' && tail[1] == 'E' && tail[2] == 'N' && tail[3] == 'D';
+  }
+
+  // A JPEG file ends with an end-of-image marker.
+  if (head[0] == 0xFF && head[1] == 0xD8) {
+    return tail[6] == 0xFF && tail[7] == 0xD9;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Returns true if stb_image can read the header of the given encoded image and the image is not
+/// truncated.
+bool isCompleteImage(std::string const& data) {
+  if (data.size() < 8) {
+    return false;
+  }
+
+  auto const* bytes = reinterpret_cast<unsigned char const*>(data.data());
+
+  int width, height, channels;
+  if (!stbi_info_from_memory(bytes, static_cast<int>(data.size()), &width, &height, &channels)) {
+    return false;
+  }
+
+  return hasEndMarker(bytes, bytes + data.size() - 8);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Same as above, but only the header and the end of the given file are read.
+bool isCompleteImageFile(std::string const& fileName) {
+  int width, height, channels;
+  if (!stbi_info(fileName.c_str(), &width, &height, &channels)) {
+    return false;
+  }
+
+  std::ifstream file(fileName, std::ifstream::binary | std::ifstream::ate);
+  auto          size = static_cast<std::streamoff>(file.tellg());
+  if (!file || size < 8) {
+    return false;
+  }
+
+  std::array<unsigned char, 4> head{};
+  std::array<unsigned char, 8> tail{};
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(head.data()), head.size());
+  file.seekg(size - 8);
+  file.read(reinterpret_cast<char*>(tail.data()), tail.size());
+
+  return file.good() && hasEndMarker(head.data(), tail.data());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Evicting files from the map cache is done when there is nothing else to download.
+const int MAINTENANCE_PRIORITY = std::numeric_limits<int>::min();
+
+// Transfers are aborted if no connection could be established within this many seconds or if
+// less than LOW_SPEED_LIMIT bytes per second were received for LOW_SPEED_TIME seconds. Otherwise,
+// a stalled server would occupy a download thread forever and block the shutdown of the pool.
+const long CONNECT_TIMEOUT = 30;
+const long LOW_SPEED_LIMIT = 1;
+const long LOW_SPEED_TIME  = 60;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+WebMapTextureLoader::WebMapTextureLoader(uint32_t downloadThreads, uint32_t decodeThreads)
+    : mShare(curl_share_init())
+    , mDownloadPool(downloadThreads)
+    , mDecodePool(decodeThreads) {
+
+  // Share open connections, resolved host names and TLS sessions between all curl handles.
+  curl_share_setopt(mShare.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+  curl_share_setopt(mShare.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(mShare.get(), CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  curl_share_setopt(mShare.get(), CURLSHOPT_LOCKFUNC, &WebMapTextureLoader::lockShare);
+  curl_share_setopt(mShare.get(), CURLSHOPT_UNLOCKFUNC, &WebMapTextureLoader::unlockShare);
+  curl_share_setopt(mShare.get(), CURLSHOPT_USERDATA, this);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 WebMapTextureLoader::~WebMapTextureLoader() {
+  // Running downloads may still enqueue decoding tasks, so the download threads are stopped
+  // first. Tasks enqueued in a pool which has been shut down are discarded.
+  mDownloadPool.shutdown();
+  mDecodePool.shutdown();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::setUseRawCache(bool enable) {
+  mUseRawCache = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::setGenerateMipmaps(bool enable) {
+  mGenerateMipmaps = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::setMapCacheQuota(uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(mMapCachesMutex);
+  mMapCacheQuota = bytes;
+
+  for (auto& [directory, cache] : mMapCaches) {
+    cache->setQuota(bytes);
+    scheduleMaintenance(*cache);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool WebMapTextureLoader::fileExist(const char* fileName) {
-  std::ifstream infile(fileName);
-  return infile.good();
+std::future<DecodedTexture> WebMapTextureLoader::loadFileAsync(
+    std::string fileName, RequestHandle handle) {
+  bool generateMipmaps = mGenerateMipmaps;
+
+  return mDecodePool.enqueue(std::move(handle), [fileName, generateMipmaps]() {
+    std::string data;
+    if (!readFile(fileName, data)) {
+      logger().error("Failed to read '{}'!", fileName);
+      return DecodedTexture();
+    }
+
+    DecodedTexture texture = decode(data, fileName);
+
+    if (generateMipmaps && texture.mData) {
+      WebMapTextureLoader::generateMipmaps(texture);
+    }
+
+    return texture;
+  });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::string WebMapTextureLoader::loadTexture(std::string time, std::string requestStr,
-    std::string const& layer, std::string const& mapCache) {
+std::future<void> WebMapTextureLoader::processAsync(
+    std::function<void()> task, RequestHandle handle) {
+  return mDecodePool.enqueue(std::move(handle), std::move(task));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::ShareDeleter::operator()(CURLSH* share) const {
+  curl_share_cleanup(share);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::lockShare(
+    CURL* /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void* userData) {
+  static_cast<WebMapTextureLoader*>(userData)->mShareMutexes.at(data).lock();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::unlockShare(CURL* /*handle*/, curl_lock_data data, void* userData) {
+  static_cast<WebMapTextureLoader*>(userData)->mShareMutexes.at(data).unlock();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<curlpp::Easy> WebMapTextureLoader::acquireConnection() {
+  std::unique_ptr<curlpp::Easy> connection;
+
+  {
+    std::unique_lock<std::mutex> lock(mConnectionsMutex);
+    if (!mIdleConnections.empty()) {
+      connection = std::move(mIdleConnections.back());
+      mIdleConnections.pop_back();
+    }
+  }
+
+  if (connection) {
+    // This removes all options of the previous request but keeps the connections open.
+    connection->reset();
+  } else {
+    connection = std::make_unique<curlpp::Easy>();
+  }
+
+  connection->setOpt(curlpp::options::NoSignal(true));
+
+  CURL* handle = connection->getHandle();
+  curl_easy_setopt(handle, CURLOPT_SHARE, mShare.get());
+  curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+  curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT);
+  curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, LOW_SPEED_LIMIT);
+  curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, LOW_SPEED_TIME);
+
+  return connection;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::releaseConnection(std::unique_ptr<curlpp::Easy> connection) {
+  std::unique_lock<std::mutex> lock(mConnectionsMutex);
+  mIdleConnections.push_back(std::move(connection));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MapCache& WebMapTextureLoader::getMapCache(std::string const& mapCache) {
+  std::lock_guard<std::mutex> lock(mMapCachesMutex);
+
+  auto& cache = mMapCaches[mapCache];
+  if (!cache) {
+    cache = std::make_unique<MapCache>(mapCache);
+    cache->setQuota(mMapCacheQuota);
+    scheduleMaintenance(*cache);
+  }
+
+  return *cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::scheduleMaintenance(MapCache& cache) {
+  if (cache.requestMaintenance()) {
+    mDownloadPool.enqueue(std::make_shared<PriorityThreadPool::TaskHandle>(MAINTENANCE_PRIORITY),
+        [&cache]() { cache.maintain(); });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string WebMapTextureLoader::getCacheFile(
+    std::string time, std::string const& layer, std::string const& mapCache) {
 
   // Replace forbidden characters in layer string before creating cache dir.
   std::string layerFixed;
@@ -74,76 +304,353 @@ std::string WebMapTextureLoader::loadTexture(std::string time, std::string reque
     }
   }
 
-  std::string cacheFile;
-
-  // Add time string to map server request if time is specified
   if (time != "") {
-    requestStr += "&TIME=";
-    requestStr += time;
-
     std::replace(time.begin(), time.end(), '/', '-');
     std::replace(time.begin(), time.end(), ':', '-');
 
-    cacheFile = cacheDir + time + ".png";
-  } else {
-    cacheFile = cacheDir + layerFixed + ".png";
+    return cacheDir + time + ".png";
   }
 
-  // No need to download the file if it is already in cache.
-  if (fileExist(cacheFile.c_str())) {
-    return cacheFile;
-  }
+  // Tiles use a path as layer name. Only its last component is used as file name.
+  return cacheDir + boost::filesystem::path(layerFixed).filename().string() + ".png";
+}
 
-  // Create cache file for write.
-  std::ofstream out;
-  out.open(cacheFile, std::ofstream::out | std::ofstream::binary);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  if (!out) {
-    logger().error("Failed to open '{}' for writing!", cacheFile);
-    return "Error";
-  }
+bool WebMapTextureLoader::download(
+    std::string const& requestStr, RequestHandle const& handle, std::string& data) {
 
-  curlpp::Easy request;
+  auto          connection = acquireConnection();
+  curlpp::Easy& request    = *connection;
   request.setOpt(curlpp::options::Url(requestStr));
-  request.setOpt(curlpp::options::WriteStream(&out));
-  request.setOpt(curlpp::options::NoSignal(true));
+  request.setOpt(curlpp::options::WriteFunction([&data](char* ptr, size_t size, size_t nmemb) {
+    data.append(ptr, size * nmemb);
+    return size * nmemb;
+  }));
+
+  // Returning a non-zero value from the progress callback makes curl abort the transfer.
+  if (handle) {
+    request.setOpt(curlpp::options::NoProgress(false));
+    request.setOpt(curlpp::options::ProgressFunction(
+        [&handle](double, double, double, double) { return handle->isCancelled() ? 1 : 0; }));
+  }
 
-  // Load to cache file.
   try {
     request.perform();
   } catch (std::exception& e) {
-    logger().error("Failed to load '{}'! Exception: '{}'", requestStr, e.what());
-    out.close();
-    remove(cacheFile.c_str());
-    return "Error";
+    if (handle && handle->isCancelled()) {
+      logger().debug("Cancelled loading '{}'.", requestStr);
+    } else {
+      logger().error("Failed to load '{}'! Exception: '{}'", requestStr, e.what());
+    }
+    releaseConnection(std::move(connection));
+    return false;
   }
 
+  long        responseCode = curlpp::infos::ResponseCode::get(request);
+  char const* contentType  = nullptr;
+  curl_easy_getinfo(request.getHandle(), CURLINFO_CONTENT_TYPE, &contentType);
+  std::string contentTypeStr = contentType ? contentType : "";
+  releaseConnection(std::move(connection));
+
+  // Map servers report errors as HTML or XML documents, sometimes even with status code 200.
+  if (responseCode < 200 || responseCode >= 300) {
+    logger().error(
+        "Failed to load '{}'! Server responded with status {}.", requestStr, responseCode);
+    return false;
+  }
+
+  if (!contentTypeStr.empty() && contentTypeStr.rfind("image/", 0) != 0) {
+    logger().error("Failed to load '{}'! Server responded with content type '{}'.", requestStr,
+        contentTypeStr);
+    return false;
+  }
+
+  if (!isCompleteImage(data)) {
+    logger().error("Failed to load '{}'! The response is not a valid image.", requestStr);
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool WebMapTextureLoader::writeCacheFile(
+    std::string const& cacheFile, std::initializer_list<std::string_view> data) {
+
+  // The data is written to a temporary file first, which is then moved into the cache. This way,
+  // a crash while writing does not leave a corrupt file in the cache. The thread ID makes the name
+  // unique between parallel requests for the same file.
+  std::string tempFile =
+      cacheFile + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+
+  std::ofstream out;
+  out.open(tempFile, std::ofstream::out | std::ofstream::binary);
+  for (auto const& chunk : data) {
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  }
   out.close();
 
-  if (curlpp::infos::ResponseCode::get(request) == 400) {
-    remove(cacheFile.c_str());
-    return "Error";
+  if (!out) {
+    logger().error("Failed to write '{}'!", tempFile);
+    remove(tempFile.c_str());
+    return false;
   }
 
-  return cacheFile;
+  // Renaming is atomic, so other threads will either see no file or the complete file.
+  try {
+    boost::filesystem::rename(tempFile, cacheFile);
+  } catch (std::exception& e) {
+    logger().error("Failed to move '{}' into the cache: '{}'!", tempFile, e.what());
+    remove(tempFile.c_str());
+    return false;
+  }
+
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::future<std::string> WebMapTextureLoader::loadTextureAsync(std::string time,
-    std::string requestStr, std::string const& layer, std::string const& mapCache) {
-  return mThreadPool.enqueue([=]() { return loadTexture(time, requestStr, layer, mapCache); });
+bool WebMapTextureLoader::readFile(std::string const& fileName, std::string& data) {
+  std::ifstream in(fileName, std::ifstream::binary | std::ifstream::ate);
+  if (!in) {
+    return false;
+  }
+
+  data.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  in.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+  return in.good();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::future<unsigned char*> WebMapTextureLoader::loadTextureFromFileAsync(
-    std::string const& fileName) {
-  return mThreadPool.enqueue([=]() {
-    int width, height, bpp;
-    int channels = 4;
-    return stbi_load(fileName.c_str(), &width, &height, &bpp, channels);
+DecodedTexture WebMapTextureLoader::decode(std::string const& data, std::string const& name) {
+  int            bpp;
+  int            channels = 4;
+  DecodedTexture texture;
+  texture.mData = std::shared_ptr<unsigned char>(
+      stbi_load_from_memory(reinterpret_cast<unsigned char const*>(data.data()),
+          static_cast<int>(data.size()), &texture.mWidth, &texture.mHeight, &bpp, channels),
+      stbi_image_free);
+
+  if (!texture.mData) {
+    logger().error("Failed to decode '{}': {}", name, stbi_failure_reason());
+    texture.mWidth  = 0;
+    texture.mHeight = 0;
+  }
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::generateMipmaps(DecodedTexture& texture) {
+  texture.mMipmaps.clear();
+
+  for (int level = 1; texture.getLevelWidth(level - 1) > 1 || texture.getLevelHeight(level - 1) > 1;
+       ++level) {
+    int srcWidth  = texture.getLevelWidth(level - 1);
+    int srcHeight = texture.getLevelHeight(level - 1);
+    int dstWidth  = texture.getLevelWidth(level);
+    int dstHeight = texture.getLevelHeight(level);
+
+    unsigned char const* src = texture.getLevelData(level - 1);
+    std::shared_ptr<unsigned char> dst(
+        new unsigned char[texture.getLevelSize(level)], std::default_delete<unsigned char[]>());
+
+    // Each pixel is the average of a 2x2 block. For odd sizes, the last row or column is reused.
+    // The inner loop works on plain bytes, so that the compiler can vectorize it.
+    for (int y = 0; y < dstHeight; ++y) {
+      unsigned char const* row0 = src + static_cast<size_t>(2 * y) * srcWidth * 4;
+      unsigned char const* row1 =
+          src + static_cast<size_t>(std::min(2 * y + 1, srcHeight - 1)) * srcWidth * 4;
+      unsigned char* out = dst.get() + static_cast<size_t>(y) * dstWidth * 4;
+
+      for (int x = 0; x < dstWidth; ++x) {
+        int x0 = 2 * x * 4;
+        int x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+
+        for (int c = 0; c < 4; ++c) {
+          out[x * 4 + c] = static_cast<unsigned char>(
+              (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+      }
+    }
+
+    texture.mMipmaps.push_back(std::move(dst));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void WebMapTextureLoader::validateCache(std::string const& mapCache) {
+  boost::filesystem::path cacheDir(mapCache);
+  boost::filesystem::path quarantineDir = cacheDir / "quarantine";
+  boost::filesystem::path indexFile     = cacheDir / MapCache::INDEX_FILE;
+
+  if (!boost::filesystem::exists(cacheDir)) {
+    return;
+  }
+
+  logger().info("Validating map cache '{}'...", mapCache);
+
+  std::vector<boost::filesystem::path> tempFiles;
+  std::vector<boost::filesystem::path> corruptFiles;
+
+  try {
+    for (auto it = boost::filesystem::recursive_directory_iterator(cacheDir);
+         it != boost::filesystem::recursive_directory_iterator(); ++it) {
+      if (it->path() == quarantineDir) {
+        it.no_push();
+        continue;
+      }
+
+      if (!boost::filesystem::is_regular_file(it->path()) || it->path() == indexFile) {
+        continue;
+      }
+
+      if (it->path().extension() == ".tmp") {
+        tempFiles.push_back(it->path());
+      } else if (it->path().extension() == RawTextureFile::EXTENSION) {
+        if (!RawTextureFile::isValid(it->path().string())) {
+          corruptFiles.push_back(it->path());
+        }
+      } else if (!isCompleteImageFile(it->path().string())) {
+        corruptFiles.push_back(it->path());
+      }
+    }
+
+    for (auto const& file : tempFiles) {
+      boost::filesystem::remove(file);
+    }
+
+    // Keep the directory structure of the cache, so that the files can be inspected later.
+    for (auto const& file : corruptFiles) {
+      auto target = quarantineDir / boost::filesystem::relative(file, cacheDir);
+      boost::filesystem::create_directories(target.parent_path());
+      boost::filesystem::rename(file, target);
+      logger().warn("Moved corrupt cache file '{}' to quarantine.", file.string());
+    }
+
+    // The index still lists the quarantined files. It is rebuilt when the cache is opened.
+    if (!corruptFiles.empty()) {
+      boost::filesystem::remove(indexFile);
+    }
+  } catch (std::exception& e) {
+    logger().error("Failed to validate map cache '{}': '{}'!", mapCache, e.what());
+    return;
+  }
+
+  logger().info("Validated map cache: Removed {} temporary and {} corrupt files.",
+      tempFiles.size(), corruptFiles.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<DecodedTexture> WebMapTextureLoader::loadTextureAsync(std::string time,
+    std::string requestStr, std::string const& layer, std::string const& mapCache,
+    RequestHandle handle, bool mipmaps) {
+
+  auto result = std::make_shared<std::promise<DecodedTexture>>();
+  auto future = result->get_future();
+
+  mDownloadPool.enqueue(handle, [=]() {
+    std::string cacheFile = getCacheFile(time, layer, mapCache);
+    if (cacheFile == "Error") {
+      result->set_value(DecodedTexture());
+      return;
+    }
+
+    // The lambdas below cannot copy the cache, so they capture this pointer.
+    MapCache* cache = &getMapCache(mapCache);
+
+    // Raw textures need no decoding, so they are returned right away.
+    // Only their mip chain has to be built on the decode threads.
+    std::string rawFile         = RawTextureFile::getFileName(cacheFile);
+    bool        useRawCache     = mUseRawCache;
+    bool        generateMipmaps = mGenerateMipmaps && mipmaps;
+
+    if (useRawCache && cache->touch(rawFile)) {
+      DecodedTexture texture = RawTextureFile::read(rawFile);
+      if (texture.mData && generateMipmaps) {
+        mDecodePool.enqueue(handle, [result, texture]() mutable {
+          WebMapTextureLoader::generateMipmaps(texture);
+          result->set_value(std::move(texture));
+        });
+        return;
+      }
+      if (texture.mData) {
+        result->set_value(std::move(texture));
+        return;
+      }
+
+      // The file has been deleted or is broken, it is replaced once the image is decoded.
+      cache->remove(rawFile);
+    }
+
+    auto data   = std::make_shared<std::string>();
+    bool cached = cache->touch(cacheFile);
+
+    if (cached && !readFile(cacheFile, *data)) {
+      cache->remove(cacheFile);
+      cached = false;
+    }
+
+    if (!cached) {
+      data->clear();
+
+      // Add time string to map server request if time is specified
+      std::string url = time != "" ? requestStr + "&TIME=" + time : requestStr;
+
+      if (!download(url, handle, *data)) {
+        result->set_value(DecodedTexture());
+        return;
+      }
+
+      // The response is decoded straight from memory. Writing it to the cache happens in the
+      // background and should not be cancelled, so it gets its own handle.
+      mDownloadPool.enqueue(std::make_shared<PriorityThreadPool::TaskHandle>(handle->getPriority()),
+          [this, cache, cacheFile, data]() {
+            if (writeCacheFile(cacheFile, {*data})) {
+              cache->insert(cacheFile, data->size());
+              scheduleMaintenance(*cache);
+            }
+          });
+    }
+
+    // If the request is cancelled before it is decoded, the promise is destroyed without a value.
+    mDecodePool.enqueue(handle, [=]() {
+      DecodedTexture texture = decode(*data, cacheFile);
+
+      // Existing cache entries are converted lazily whenever they are decoded.
+      if (useRawCache && texture.mData) {
+        mDownloadPool.enqueue(
+            std::make_shared<PriorityThreadPool::TaskHandle>(handle->getPriority()),
+            [this, cache, texture, rawFile]() {
+              auto header = RawTextureFile::createHeader(texture.mWidth, texture.mHeight);
+              if (writeCacheFile(rawFile,
+                      {std::string_view(reinterpret_cast<char const*>(&header), sizeof(header)),
+                          std::string_view(reinterpret_cast<char const*>(texture.mData.get()),
+                              texture.getSize())})) {
+                cache->insert(rawFile, sizeof(header) + texture.getSize());
+                scheduleMaintenance(*cache);
+              }
+            });
+      }
+
+      if (generateMipmaps && texture.mData) {
+        WebMapTextureLoader::generateMipmaps(texture);
+      }
+
+      result->set_value(std::move(texture));
+    });
   });
+
+  return future;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -7,32 +7,184 @@
 #ifndef CSP_WMS_TEXTURE_LOADER_HPP
 #define CSP_WMS_TEXTURE_LOADER_HPP
 
-#include "../../../src/cs-utils/ThreadPool.hpp"
+#include "MapCache.hpp"
+#include "PriorityThreadPool.hpp"
+
+#include <curlpp/Easy.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
 
 namespace csp::simplewmsbodies {
 
+/// A decoded WMS image with four 8-bit channels per pixel. The pixel data is freed once the last
+/// copy of the texture is destroyed. It is either allocated on the heap or points into a memory
+/// mapped RawTextureFile; in the latter case it must not be modified.
+/// If mipmaps have been generated, mMipmaps contains the levels 1 to n of the mip chain. Each level
+/// is half as large as the previous one, down to a single pixel.
+struct DecodedTexture {
+  std::shared_ptr<unsigned char> mData;       ///< The RGBA pixel data, nullptr if loading failed.
+  int                            mWidth  = 0; ///< The width of the image in pixels.
+  int                            mHeight = 0; ///< The height of the image in pixels.
+  std::vector<std::shared_ptr<unsigned char>> mMipmaps; ///< The levels below the full image.
+
+  /// The size of the pixel data of the full image in bytes.
+  size_t getSize() const {
+    return static_cast<size_t>(mWidth) * static_cast<size_t>(mHeight) * 4;
+  }
+
+  /// The number of levels including the full image.
+  int getLevelCount() const {
+    return 1 + static_cast<int>(mMipmaps.size());
+  }
+
+  int getLevelWidth(int level) const {
+    return std::max(1, mWidth >> level);
+  }
+
+  int getLevelHeight(int level) const {
+    return std::max(1, mHeight >> level);
+  }
+
+  size_t getLevelSize(int level) const {
+    return static_cast<size_t>(getLevelWidth(level)) * getLevelHeight(level) * 4;
+  }
+
+  unsigned char* getLevelData(int level) const {
+    return level == 0 ? mData.get() : mMipmaps[level - 1].get();
+  }
+
+  /// The size of all levels in bytes.
+  size_t getTotalSize() const {
+    size_t size = 0;
+    for (int level = 0; level < getLevelCount(); ++level) {
+      size += getLevelSize(level);
+    }
+    return size;
+  }
+};
+
+/// The WebMapTextureLoader is shared by all bodies of the plugin. It downloads WMS images with a
+/// pool of I/O threads and decodes them with a separate pool of decode threads. Downloaded images
+/// are decoded directly from memory while they are written to the map cache in the background.
+/// All requests carry
+/// a handle with a priority, so that the current timestep of the active body is loaded before
+/// textures which are only pre-fetched. The handle can also be used to re-prioritize or cancel a
+/// request once it is not needed anymore.
+/// Curl handles are pooled and share their connection cache, so that consecutive requests to the
+/// same map server do not pay for a new TCP and TLS handshake. HTTP/2 is used if the server
+/// supports it.
 class WebMapTextureLoader {
  public:
-  /// Create a new ThreadPool with the specified amount of threads.
-  WebMapTextureLoader();
+  using RequestHandle = std::shared_ptr<PriorityThreadPool::TaskHandle>;
+
+  /// Create the two thread pools with the specified amount of threads.
+  WebMapTextureLoader(uint32_t downloadThreads, uint32_t decodeThreads);
 
   ~WebMapTextureLoader();
 
-  /// Async WMS texture loader.
-  std::future<std::string> loadTextureAsync(std::string time, std::string requestStr,
-      std::string const& layer, std::string const& mapCache);
+  /// Async WMS texture loader. The texture is read from the map cache or downloaded if it is not
+  /// cached yet. Requests with a larger priority are executed first. If the request is cancelled
+  /// while the texture is downloaded, the transfer is aborted. A texture without data is returned
+  /// if loading failed. If mipmaps is false, no mip chain is built for this texture even if mipmap
+  /// generation is enabled.
+  std::future<DecodedTexture> loadTextureAsync(std::string time, std::string requestStr,
+      std::string const& layer, std::string const& mapCache, RequestHandle handle,
+      bool mipmaps = true);
+
+  /// Reads and decodes the given image file on the decode threads. If enabled, its mip chain is
+  /// built as well. A texture without data is returned if the file cannot be read or decoded.
+  std::future<DecodedTexture> loadFileAsync(std::string fileName, RequestHandle handle);
+
+  /// If enabled, decoded textures are stored in the map cache as RawTextureFiles next to the
+  /// images from the map server. Later requests for the same texture then skip decoding.
+  void setUseRawCache(bool enable);
+
+  /// If enabled, the decode threads build a full mip chain for each texture.
+  void setGenerateMipmaps(bool enable);
+
+  /// Sets the maximum size of each map cache in bytes. Zero means unlimited. If a cache grows
+  /// larger, its least recently used files are deleted in the background.
+  void setMapCacheQuota(uint64_t bytes);
 
-  /// WMS texture loader.
-  std::string loadTexture(std::string time, std::string requestStr, std::string const& layer,
-      std::string const& mapCache);
+  /// Runs the given function on the decode threads. This can be used for other CPU-bound work on
+  /// textures, such as copying them to pixel buffer objects.
+  std::future<void> processAsync(std::function<void()> task, RequestHandle handle);
 
-  /// Load WMS texture from file using stbi.
-  std::future<unsigned char*> loadTextureFromFileAsync(std::string const& fileName);
+  /// Scans the given map cache for files which are not complete images, for example because the
+  /// application was killed while writing them. Such files are moved to a "quarantine" directory
+  /// inside the map cache. Left-over temporary files are deleted. This walks the entire cache, so
+  /// it should not run while textures are loaded. It has to be called before the cache is opened
+  /// by the loader, as the index of the cache is not updated.
+  static void validateCache(std::string const& mapCache);
 
  private:
-  bool fileExist(const char* fileName);
+  /// Returns the index of the given map cache directory. It is opened on first use.
+  MapCache& getMapCache(std::string const& mapCache);
+
+  /// Evicts files from the given cache on the download threads if it exceeds its quota.
+  void scheduleMaintenance(MapCache& cache);
+
+  /// Returns the path of the cache file for the given time and layer and creates its directory.
+  /// Returns "Error" if the directory cannot be created.
+  static std::string getCacheFile(
+      std::string time, std::string const& layer, std::string const& mapCache);
+
+  /// Downloads the given URL to memory. Returns false if the transfer failed, was cancelled or
+  /// did not result in a complete image.
+  bool download(std::string const& requestStr, RequestHandle const& handle, std::string& data);
+
+  /// Atomically writes the concatenation of the given chunks to the map cache.
+  static bool writeCacheFile(
+      std::string const& cacheFile, std::initializer_list<std::string_view> data);
+
+  static bool readFile(std::string const& fileName, std::string& data);
+
+  /// Decodes the given image with stbi. The name is only used for error messages.
+  static DecodedTexture decode(std::string const& data, std::string const& name);
+
+  /// Builds the mip chain of the given texture with a 2x2 box filter.
+  static void generateMipmaps(DecodedTexture& texture);
+
+  /// Returns an idle curl handle or creates a new one. The handle is configured to use the shared
+  /// connection cache.
+  std::unique_ptr<curlpp::Easy> acquireConnection();
+
+  /// Returns the handle to the pool of idle handles. Its connections stay open for reuse.
+  void releaseConnection(std::unique_ptr<curlpp::Easy> connection);
+
+  static void lockShare(CURL* handle, curl_lock_data data, curl_lock_access access, void* userData);
+  static void unlockShare(CURL* handle, curl_lock_data data, void* userData);
+
+  struct ShareDeleter {
+    void operator()(CURLSH* share) const;
+  };
+
+  std::array<std::mutex, CURL_LOCK_DATA_LAST> mShareMutexes;
+  std::unique_ptr<CURLSH, ShareDeleter>       mShare;
+
+  std::atomic<bool> mUseRawCache{false};
+  std::atomic<bool> mGenerateMipmaps{true};
+
+  std::mutex                                 mConnectionsMutex;
+  std::vector<std::unique_ptr<curlpp::Easy>> mIdleConnections;
+
+  std::mutex                                       mMapCachesMutex;
+  std::map<std::string, std::unique_ptr<MapCache>> mMapCaches;
+  std::atomic<uint64_t>                            mMapCacheQuota{0};
 
-  cs::utils::ThreadPool mThreadPool;
+  // Tasks of each pool enqueue follow-up tasks in the other one. Therefore, both pools are shut
+  // down explicitly in the destructor, before any of them or the other members is destroyed.
+  PriorityThreadPool mDownloadPool;
+  PriorityThreadPool mDecodePool;
 };
 
 } // namespace csp::simplewmsbodies
@@ -8,9 +8,27 @@
 
 #include "../../../src/cs-utils/logger.hpp"
 #include "../../../src/cs-utils/utils.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cctype>
 
 namespace csp::simplewmsbodies::utils {
 
+namespace {
+
+std::string_view trim(std::string_view input) {
+  while (!input.empty() && std::isspace(static_cast<unsigned char>(input.front()))) {
+    input.remove_prefix(1);
+  }
+  while (!input.empty() && std::isspace(static_cast<unsigned char>(input.back()))) {
+    input.remove_suffix(1);
+  }
+  return input;
+}
+
+} // namespace
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::string timeToString(std::string const& format, boost::posix_time::ptime time) {
@@ -25,54 +43,11 @@ std::string timeToString(std::string const& format, boost::posix_time::ptime tim
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void matchDuration(std::string const& input, std::regex const& re, int& duration) {
-  std::smatch match;
-  std::regex_search(input, match, re);
-
-  if (match.empty()) {
-    spdlog::debug("Pattern does not match!");
-    return;
-  }
-
-  std::vector<int> vec = {0, 0, 0, 0, 0, 0}; // years, months, days, hours, minutes, seconds
-
-  for (size_t i = 1; i < match.size(); ++i) {
-    if (match[i].matched) {
-      std::string str = match[i];
-      str.pop_back(); // remove last character.
-      vec[i - 1] = static_cast<int>(std::stod(str));
-    }
-  }
-
-  duration = 31556926 * vec[0] + // years
-             2629744 * vec[1] +  // months
-             86400 * vec[2] +    // days
-             3600 * vec[3] +     // hours
-             60 * vec[4] +       // minutes
-             1 * vec[5];         // seconds
+void timeDuration(std::string_view isoString, int& duration, std::string& format) {
+  duration = parseDuration(isoString);
 
   if (duration == 0) {
-    spdlog::debug("Input is not valid!");
-    return;
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-void timeDuration(std::string const& isoString, int& duration, std::string& format) {
-  std::regex rshort("^((?!T).)*$");
-  duration = 0;
-  format   = "";
-
-  // Check if isoString matches rshort.
-  if (std::regex_match(isoString, rshort)) // no T (Time) exist
-  {
-    std::regex r("P([[:d:]]+Y)?([[:d:]]+M)?([[:d:]]+D)?");
-    matchDuration(isoString, r, duration);
-  } else {
-    std::regex r("P([[:d:]]+Y)?([[:d:]]+M)?([[:d:]]+D)?T([[:d:]]+H)?([[:d:]]+M)?([[:d:]]+S|[[:d:]]+"
-                 "\\.[[:d:]]+S)?");
-    matchDuration(isoString, r, duration);
+    logger().debug("'{}' is not a valid duration!", isoString);
   }
 
   // Create string format based on interval duration (day / month / year / time).
@@ -89,50 +64,55 @@ void timeDuration(std::string const& isoString, int& duration, std::string& form
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void convertIsoDate(std::string& date, boost::posix_time::ptime& time) {
+void convertIsoDate(std::string_view date, boost::posix_time::ptime& time) {
   if (date == "current") {
     time = boost::posix_time::microsec_clock::universal_time();
     return;
   }
 
-  date.erase(
-      std::remove_if(date.begin(), date.end(), [](unsigned char x) { return std::ispunct(x); }),
-      date.end());
+  IsoDate iso = parseIsoDate(date);
 
-  std::string dateSubStr = date.substr(0, date.find("T"));
-  std::size_t pos        = date.find("T");
-  std::string timeSubStr = "T";
-
-  if (pos != std::string::npos) {
-    timeSubStr = date.substr(pos);
-  }
-
-  dateSubStr.resize(8, '0');
-  timeSubStr.resize(7, '0');
-  time = boost::posix_time::from_iso_string(dateSubStr + timeSubStr);
+  // This throws an exception for invalid dates.
+  time = boost::posix_time::ptime(boost::gregorian::date(static_cast<unsigned short>(iso.mYear),
+                                      static_cast<unsigned short>(iso.mMonth),
+                                      static_cast<unsigned short>(iso.mDay)),
+      boost::posix_time::hours(iso.mHour) + boost::posix_time::minutes(iso.mMinute) +
+          boost::posix_time::seconds(iso.mSecond));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void parseIsoString(std::string const& isoString, std::vector<TimeInterval>& timeIntervals) {
-  std::string       timeRange;
-  std::stringstream iso_stringstream(isoString);
-
-  // Read time intervalls.
-  while (std::getline(iso_stringstream, timeRange, ',')) {
-    std::string       startDate, endDate, duration;
-    std::stringstream timeRange_stringstream(timeRange);
+void parseIsoString(std::string_view isoString, std::vector<TimeInterval>& timeIntervals) {
+  timeIntervals.reserve(
+      timeIntervals.size() + std::count(isoString.begin(), isoString.end(), ',') + 1);
+
+  // Returns the part of the input up to the given separator and removes it including the
+  // separator from the input.
+  auto next = [](std::string_view& input, char separator) {
+    size_t           pos  = input.find(separator);
+    std::string_view part = input.substr(0, pos);
+    input.remove_prefix(pos == std::string_view::npos ? input.size() : pos + 1);
+    return trim(part);
+  };
+
+  // Read time intervals.
+  while (!isoString.empty()) {
+    std::string_view timeRange = next(isoString, ',');
+
+    if (timeRange.empty()) {
+      continue;
+    }
 
-    std::getline(timeRange_stringstream, startDate, '/');
-    std::getline(timeRange_stringstream, endDate, '/');
-    std::getline(timeRange_stringstream, duration, '/');
+    std::string_view startDate = next(timeRange, '/');
+    std::string_view endDate   = next(timeRange, '/');
+    std::string_view duration  = next(timeRange, '/');
 
     TimeInterval             tmp;
     boost::posix_time::ptime start, end;
     convertIsoDate(startDate, start);
 
     // If there is no end date, just a single timestep.
-    if (endDate == "") {
+    if (endDate.empty()) {
       end                   = start;
       tmp.mIntervalDuration = 0;
       tmp.mFormat           = "%Y-%m-%dT%H:%M:%SZ";
@@ -143,29 +123,8 @@ void parseIsoString(std::string const& isoString, std::vector<TimeInterval>& tim
 
     tmp.mEndTime   = end;
     tmp.mStartTime = start;
-    timeIntervals.push_back(tmp);
-  }
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-
-bool timeInIntervals(boost::posix_time::ptime time, std::vector<TimeInterval>& timeIntervals,
-    boost::posix_time::time_duration& timeSinceStart, int& intervalDuration, std::string& format) {
-  // Check each interval whether the given time is inside or not..
-  for (int i = 0; i < timeIntervals.size(); i++) {
-    boost::posix_time::time_duration td =
-        boost::posix_time::seconds(timeIntervals.at(i).mIntervalDuration);
-
-    if (timeIntervals.at(i).mStartTime <= time && timeIntervals.at(i).mEndTime + td >= time) {
-      timeSinceStart   = time - timeIntervals.at(i).mStartTime;
-      intervalDuration = timeIntervals.at(i).mIntervalDuration;
-      format           = timeIntervals.at(i).mFormat;
-      return true;
-    }
+    timeIntervals.push_back(std::move(tmp));
   }
-
-  // Time is not in any of the intervals.
-  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -9,8 +9,11 @@
 
 #include "../../../src/cs-utils/convert.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <optional>
-#include <regex>
+#include <string_view>
 
 namespace csp::simplewmsbodies {
 
@@ -24,24 +27,164 @@ struct TimeInterval {
 
 namespace utils {
 
+namespace detail {
+
+constexpr bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+/// Like std::ispunct() in the "C" locale.
+constexpr bool isPunct(char c) {
+  return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') ||
+         (c >= '{' && c <= '~');
+}
+
+} // namespace detail
+
 /// Create formatted date, time string from time value.
 std::string timeToString(std::string const& format, boost::posix_time::ptime time);
 
-/// Match years, months, days, etc. in regex input string and calculate duration.
-void matchDuration(std::string const& input, std::regex const& re, int& duration);
+/// Parse an ISO 8601 duration like "P1Y2M10DT2H30M" and return its length in seconds. Years and
+/// months are converted with their average length, fractions of seconds are dropped. Returns
+/// zero if the input contains no duration or if the duration does not fit into an int.
+constexpr int parseDuration(std::string_view input) {
+  size_t i = input.find('P');
+
+  if (i == std::string_view::npos) {
+    return 0;
+  }
+
+  int64_t duration = 0;
+  bool    inTime   = false;
+
+  // Each component is a number followed by a designator. After the 'T', an 'M' means minutes.
+  for (++i; i < input.size(); ++i) {
+    if (input[i] == 'T') {
+      inTime = true;
+      continue;
+    }
+
+    if (!detail::isDigit(input[i])) {
+      break;
+    }
+
+    int64_t value = 0;
+    while (i < input.size() && detail::isDigit(input[i])) {
+      // Even as seconds, larger values would not fit into an int.
+      if (value > std::numeric_limits<int>::max()) {
+        return 0;
+      }
+
+      value = value * 10 + (input[i] - '0');
+      ++i;
+    }
+
+    // Fractions are only used for seconds and are dropped.
+    if (i < input.size() && (input[i] == '.' || input[i] == ',')) {
+      do {
+        ++i;
+      } while (i < input.size() && detail::isDigit(input[i]));
+    }
+
+    if (i == input.size()) {
+      break;
+    }
+
+    char    designator = input[i];
+    int64_t unit       = 0;
+
+    if (!inTime && designator == 'Y') {
+      unit = 31556926;
+    } else if (!inTime && designator == 'M') {
+      unit = 2629744;
+    } else if (!inTime && designator == 'D') {
+      unit = 86400;
+    } else if (inTime && designator == 'H') {
+      unit = 3600;
+    } else if (inTime && designator == 'M') {
+      unit = 60;
+    } else if (inTime && designator == 'S') {
+      unit = 1;
+    } else {
+      break;
+    }
+
+    duration += unit * value;
+
+    if (duration > std::numeric_limits<int>::max()) {
+      return 0;
+    }
+  }
+
+  return static_cast<int>(duration);
+}
+
+/// The components of a point in time as given in an ISO 8601 string.
+struct IsoDate {
+  int mYear   = 0;
+  int mMonth  = 1;
+  int mDay    = 1;
+  int mHour   = 0;
+  int mMinute = 0;
+  int mSecond = 0;
+};
+
+/// Parse the components of an ISO 8601 date. Punctuation is ignored, so both the basic and the
+/// extended format are supported. Missing time components are set to zero, a missing month or day
+/// to one. The components are not validated.
+constexpr IsoDate parseIsoDate(std::string_view date) {
+  // The digits are collected in the basic format "YYYYMMDDhhmmss". The date part ends at the 'T',
+  // both parts end at the first character which is neither a digit nor punctuation, for example
+  // at a 'Z'.
+  int    digits[14] = {};
+  size_t count      = 0;
+  size_t end        = 8;
+
+  for (char c : date) {
+    if (c == 'T' && end == 8) {
+      count = 8;
+      end   = 14;
+    } else if (detail::isDigit(c)) {
+      if (count < end) {
+        digits[count++] = c - '0';
+      }
+    } else if (!detail::isPunct(c)) {
+      if (end == 14) {
+        break;
+      }
+      count = end;
+    }
+  }
+
+  auto number = [&digits](int first, int length) {
+    int value = 0;
+    for (int i = first; i < first + length; ++i) {
+      value = value * 10 + digits[i];
+    }
+    return value;
+  };
+
+  IsoDate result;
+  result.mYear   = number(0, 4);
+  result.mMonth  = std::max(number(4, 2), 1);
+  result.mDay    = std::max(number(6, 2), 1);
+  result.mHour   = number(8, 2);
+  result.mMinute = number(10, 2);
+  result.mSecond = number(12, 2);
 
-/// Determine time format and interval duration from string regex.
-void timeDuration(std::string const& isoString, int& duration, std::string& format);
+  return result;
+}
 
-/// Convert date from string to time.
-void convertIsoDate(std::string& date, boost::posix_time::ptime& time);
+/// Determine time format and interval duration from an ISO 8601 duration string.
+void timeDuration(std::string_view isoString, int& duration, std::string& format);
 
-/// Parse time intervals from string.
-void parseIsoString(std::string const& isoString, std::vector<TimeInterval>& timeIntervals);
+/// Convert date from an ISO 8601 string to time, see parseIsoDate(). The string "current" is
+/// converted to the current time. Throws an exception if the date is invalid.
+void convertIsoDate(std::string_view date, boost::posix_time::ptime& time);
 
-/// Check whether the given time is inside one of the time intervals.
-bool timeInIntervals(boost::posix_time::ptime time, std::vector<TimeInterval>& timeIntervals,
-    boost::posix_time::time_duration& timeSinceStart, int& intervalDuration, std::string& format);
+/// Parse a comma-separated list of time intervals ("start/end/duration") and single points in
+/// time from string.
+void parseIsoString(std::string_view isoString, std::vector<TimeInterval>& timeIntervals);
 
 } // namespace utils
 
@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/MapCache.hpp"
+
+#include <boost/filesystem.hpp>
+#include <doctest.h>
+
+#include <fstream>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+// Creates an empty cache directory in the temporary directory and removes it again.
+class TemporaryCache {
+ public:
+  TemporaryCache()
+      : mDirectory((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+                       .generic_string()) {
+    boost::filesystem::create_directories(mDirectory);
+  }
+
+  TemporaryCache(TemporaryCache const& other) = delete;
+  TemporaryCache(TemporaryCache&& other)      = delete;
+
+  TemporaryCache& operator=(TemporaryCache const& other) = delete;
+  TemporaryCache& operator=(TemporaryCache&& other) = delete;
+
+  ~TemporaryCache() {
+    boost::system::error_code error;
+    boost::filesystem::remove_all(mDirectory, error);
+  }
+
+  /// Creates a file of the given size in the cache directory and returns its path.
+  std::string createFile(std::string const& name, size_t size) const {
+    std::string path = getPath(name);
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path());
+    std::ofstream(path, std::ofstream::binary) << std::string(size, 'x');
+    return path;
+  }
+
+  /// Appends the given text to the log of the cache.
+  void appendToLog(std::string const& text) const {
+    std::ofstream(getPath(MapCache::INDEX_FILE), std::ofstream::app | std::ofstream::binary)
+        << text;
+  }
+
+  std::string getPath(std::string const& name) const {
+    return mDirectory + "/" + name;
+  }
+
+  std::string const& getDirectory() const {
+    return mDirectory;
+  }
+
+ private:
+  std::string mDirectory;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MapCache indexes existing caches without a log") {
+  TemporaryCache directory;
+  directory.createFile("layer/2020/a.png", 100);
+  directory.createFile("layer/2020/b.png.tmp", 100);
+  directory.createFile("quarantine/layer/c.png", 100);
+
+  MapCache cache(directory.getDirectory());
+
+  CHECK(cache.touch(directory.getPath("layer/2020/a.png")));
+  CHECK_FALSE(cache.touch(directory.getPath("layer/2020/b.png.tmp")));
+  CHECK_FALSE(cache.touch(directory.getPath("quarantine/layer/c.png")));
+  CHECK(boost::filesystem::exists(directory.getPath(MapCache::INDEX_FILE)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MapCache replays its log") {
+  TemporaryCache directory;
+  directory.appendToLog("+ 100 10 layer/a.png\n"
+                        "+ 200 10 layer/with space.png\n"
+                        "+ 300 10 layer/b.png\n"
+                        "* 20 layer/a.png\n"
+                        "- layer/b.png\n");
+
+  {
+    MapCache cache(directory.getDirectory() + "/");
+
+    CHECK(cache.touch(directory.getPath("layer/a.png")));
+    CHECK(cache.touch(directory.getPath("layer/with space.png")));
+    CHECK_FALSE(cache.touch(directory.getPath("layer/b.png")));
+
+    cache.insert(directory.getPath("layer/c.png"), 400);
+    cache.remove(directory.getPath("layer/a.png"));
+  }
+
+  // The changes of the previous session have been appended to the log.
+  MapCache cache(directory.getDirectory());
+
+  CHECK_FALSE(cache.touch(directory.getPath("layer/a.png")));
+  CHECK(cache.touch(directory.getPath("layer/with space.png")));
+  CHECK(cache.touch(directory.getPath("layer/c.png")));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MapCache ignores a truncated last record") {
+  TemporaryCache directory;
+  directory.appendToLog("+ 100 10 layer/a.png\n"
+                        "+ 100 10 layer/trunc");
+
+  {
+    MapCache cache(directory.getDirectory());
+
+    CHECK(cache.touch(directory.getPath("layer/a.png")));
+    CHECK_FALSE(cache.touch(directory.getPath("layer/trunc")));
+
+    // This must not be appended to the incomplete record.
+    cache.insert(directory.getPath("layer/b.png"), 100);
+  }
+
+  MapCache cache(directory.getDirectory());
+
+  CHECK(cache.touch(directory.getPath("layer/a.png")));
+  CHECK(cache.touch(directory.getPath("layer/b.png")));
+  CHECK_FALSE(cache.touch(directory.getPath("layer/trunc")));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("MapCache evicts the least recently used files") {
+  TemporaryCache directory;
+  std::string    a = directory.createFile("layer/a.png", 1000);
+  std::string    b = directory.createFile("layer/b.png", 1000);
+  std::string    c = directory.createFile("layer/c.png", 1000);
+
+  directory.appendToLog("+ 1000 100 layer/a.png\n"
+                        "+ 1000 300 layer/b.png\n"
+                        "+ 1000 200 layer/c.png\n");
+
+  MapCache cache(directory.getDirectory());
+
+  CHECK_FALSE(cache.requestMaintenance());
+
+  // The files are deleted until the cache is at 90% of its quota, which is only the oldest one.
+  cache.setQuota(2500);
+  REQUIRE(cache.requestMaintenance());
+  CHECK_FALSE(cache.requestMaintenance());
+
+  cache.maintain();
+
+  CHECK_FALSE(boost::filesystem::exists(a));
+  CHECK(boost::filesystem::exists(b));
+  CHECK(boost::filesystem::exists(c));
+
+  CHECK_FALSE(cache.touch(a));
+  CHECK(cache.touch(b));
+  CHECK(cache.touch(c));
+  CHECK_FALSE(cache.requestMaintenance());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/PrefetchPlanner.hpp"
+
+#include <doctest.h>
+
+namespace csp::simplewmsbodies {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PrefetchPlanner loads both sides of the current timestep while paused") {
+  PrefetchPlanner  planner;
+  std::vector<int> offsets;
+
+  planner.plan(10, 0.0, offsets);
+  CHECK(offsets == std::vector<int>{0});
+
+  planner.setPrefetchCount(2);
+  planner.addLatencySample(1.0);
+
+  planner.plan(10, 0.0, offsets);
+  CHECK(offsets == std::vector<int>{0, 1, -1, 2, -2});
+
+  // Less than one timestep passes while a texture is loaded.
+  planner.plan(10, 0.5, offsets);
+  CHECK(offsets == std::vector<int>{0, 1, -1, 2, -2});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PrefetchPlanner looks ahead in the direction of playback") {
+  PrefetchPlanner  planner;
+  std::vector<int> offsets;
+
+  planner.setPrefetchCount(2);
+  planner.addLatencySample(1.0);
+
+  // Three timesteps pass during one request, so every second one of the timesteps after that is
+  // loaded. The following timestep is always loaded for interpolation.
+  planner.plan(10, 3.0, offsets);
+  CHECK(offsets == std::vector<int>{0, 1, 4, 6});
+
+  planner.plan(10, -3.0, offsets);
+  CHECK(offsets == std::vector<int>{0, 1, -4, -6});
+
+  // The selected timesteps are aligned to the stride, so they do not change in the next frame.
+  planner.plan(11, 3.0, offsets);
+  CHECK(offsets == std::vector<int>{0, 1, 3, 5});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PrefetchPlanner averages the latency") {
+  PrefetchPlanner planner;
+  CHECK(planner.getLatency() == 0.0);
+
+  planner.addLatencySample(1.0);
+  CHECK(planner.getLatency() == doctest::Approx(1.0));
+
+  planner.addLatencySample(2.0);
+  CHECK(planner.getLatency() == doctest::Approx(1.2));
+
+  planner.resetLatency();
+  planner.addLatencySample(3.0);
+  CHECK(planner.getLatency() == doctest::Approx(3.0));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/PriorityThreadPool.hpp"
+
+#include <doctest.h>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+// Occupies the only worker of the given pool until the returned promise is fulfilled, so that
+// tasks can be enqueued before any of them is picked up.
+std::promise<void> blockWorker(PriorityThreadPool& pool) {
+  std::promise<void> release;
+  std::promise<void> started;
+
+  pool.enqueue(std::make_shared<PriorityThreadPool::TaskHandle>(0),
+      [&started, blocker = release.get_future().share()]() {
+        started.set_value();
+        blocker.wait();
+      });
+
+  started.get_future().wait();
+  return release;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PriorityThreadPool executes tasks with higher priority first") {
+  PriorityThreadPool pool(1);
+  auto               release = blockWorker(pool);
+
+  std::vector<int>               order;
+  std::vector<std::future<void>> results;
+
+  for (int priority : {1, 3, 2, 3, 0}) {
+    results.push_back(pool.enqueue(std::make_shared<PriorityThreadPool::TaskHandle>(priority),
+        [&order, priority, index = results.size()]() {
+          order.push_back(priority * 10 + static_cast<int>(index));
+        }));
+  }
+
+  CHECK(pool.getPendingTaskCount() == 5);
+
+  release.set_value();
+  for (auto& result : results) {
+    result.wait();
+  }
+
+  // Tasks with the same priority are executed in the order in which they were enqueued.
+  CHECK(order == std::vector<int>{31, 33, 22, 10, 4});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PriorityThreadPool skips cancelled tasks and respects changed priorities") {
+  PriorityThreadPool pool(1);
+  auto               release = blockWorker(pool);
+
+  std::vector<int> order;
+
+  auto first     = std::make_shared<PriorityThreadPool::TaskHandle>(2);
+  auto second    = std::make_shared<PriorityThreadPool::TaskHandle>(1);
+  auto cancelled = std::make_shared<PriorityThreadPool::TaskHandle>(3);
+
+  auto firstResult     = pool.enqueue(first, [&order]() { order.push_back(1); });
+  auto secondResult    = pool.enqueue(second, [&order]() { order.push_back(2); });
+  auto cancelledResult = pool.enqueue(cancelled, [&order]() { order.push_back(3); });
+
+  cancelled->cancel();
+  second->setPriority(5);
+
+  release.set_value();
+  firstResult.wait();
+  secondResult.wait();
+
+  CHECK(order == std::vector<int>{2, 1});
+  CHECK(cancelled->isCancelled());
+  CHECK_THROWS(cancelledResult.get());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("PriorityThreadPool discards tasks after shutdown") {
+  PriorityThreadPool pool(1);
+  auto               release = blockWorker(pool);
+
+  bool executed = false;
+  auto pending  = pool.enqueue(
+      std::make_shared<PriorityThreadPool::TaskHandle>(0), [&executed]() { executed = true; });
+
+  release.set_value();
+  pool.shutdown();
+
+  auto late = pool.enqueue(
+      std::make_shared<PriorityThreadPool::TaskHandle>(0), [&executed]() { executed = true; });
+
+  // The pending task may have been picked up before the pool stopped, the late one never runs.
+  if (!executed) {
+    CHECK_THROWS(pending.get());
+  }
+
+  CHECK_THROWS(late.get());
+  CHECK(pool.getPendingTaskCount() == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TextureCache.hpp"
+
+#include <doctest.h>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+// Returns a texture with 4 KB of pixel data.
+DecodedTexture createTexture() {
+  DecodedTexture texture;
+  texture.mWidth  = 32;
+  texture.mHeight = 32;
+  texture.mData   = std::shared_ptr<unsigned char>(
+      new unsigned char[texture.getSize()], std::default_delete<unsigned char[]>());
+  return texture;
+}
+
+const size_t TEXTURE_SIZE = 32 * 32 * 4;
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureCache evicts the least recently used texture of all caches") {
+  TextureCache::setGlobalBudget(3 * TEXTURE_SIZE);
+
+  TextureCache other;
+  other.insert({0, 0}, createTexture());
+  other.insert({0, 1}, createTexture());
+  other.insert({0, 2}, createTexture());
+
+  // The new texture has to stay, the least recently used one of the other cache is evicted.
+  TextureCache cache;
+  cache.insert({0, 0}, createTexture());
+
+  CHECK(cache.contains({0, 0}));
+  CHECK_FALSE(other.contains({0, 0}));
+  CHECK(other.contains({0, 1}));
+  CHECK(other.contains({0, 2}));
+
+  // Using a texture protects it from being evicted next.
+  other.get({0, 1});
+  cache.insert({0, 1}, createTexture());
+
+  CHECK(cache.contains({0, 0}));
+  CHECK(cache.contains({0, 1}));
+  CHECK(other.contains({0, 1}));
+  CHECK_FALSE(other.contains({0, 2}));
+
+  TextureCache::setGlobalBudget(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureCache keeps a texture which exceeds the budget") {
+  TextureCache cache;
+  cache.setBudget(TEXTURE_SIZE / 2);
+
+  cache.insert({0, 0}, createTexture());
+  CHECK(cache.contains({0, 0}));
+
+  cache.insert({0, 1}, createTexture());
+  CHECK(cache.contains({0, 1}));
+  CHECK_FALSE(cache.contains({0, 0}));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureCache does not evict pinned textures") {
+  TextureCache cache;
+  cache.setBudget(2 * TEXTURE_SIZE);
+
+  cache.insert({0, 0}, createTexture());
+  cache.setPinned({{0, 0}});
+  cache.insert({0, 1}, createTexture());
+  cache.insert({0, 2}, createTexture());
+
+  CHECK(cache.contains({0, 0}));
+  CHECK_FALSE(cache.contains({0, 1}));
+  CHECK(cache.contains({0, 2}));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
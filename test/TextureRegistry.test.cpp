@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TextureRegistry.hpp"
+
+#include <boost/filesystem.hpp>
+#include <doctest.h>
+
+#include <fstream>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+// Creates a file in the temporary directory and removes it again. The content does not need to
+// be a valid image, the registry only tracks whether decoding has been started.
+class TemporaryFile {
+ public:
+  explicit TemporaryFile(std::string const& extension)
+      : mPath((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+                  .generic_string() +
+              extension) {
+    std::ofstream(mPath) << "not an image";
+  }
+
+  TemporaryFile(TemporaryFile const& other) = delete;
+  TemporaryFile(TemporaryFile&& other)      = delete;
+
+  TemporaryFile& operator=(TemporaryFile const& other) = delete;
+  TemporaryFile& operator=(TemporaryFile&& other) = delete;
+
+  ~TemporaryFile() {
+    boost::system::error_code error;
+    boost::filesystem::remove(mPath, error);
+  }
+
+  std::string const& getPath() const {
+    return mPath;
+  }
+
+ private:
+  std::string mPath;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureRegistry identifies files by their path and modification time") {
+  TemporaryFile   file(".png");
+  TextureRegistry registry(std::make_shared<WebMapTextureLoader>(1, 1));
+
+  CHECK_FALSE(registry.isPending(file.getPath()));
+
+  registry.prepare(file.getPath());
+  CHECK(registry.isPending(file.getPath()));
+
+  // Preparing the same version again does not start another decoding.
+  registry.prepare(file.getPath());
+  registry.wait(file.getPath());
+  CHECK(registry.isPending(file.getPath()));
+
+  // A changed file is a new version which has to be prepared again.
+  std::time_t modified = boost::filesystem::last_write_time(file.getPath());
+  boost::filesystem::last_write_time(file.getPath(), modified - 10);
+  CHECK_FALSE(registry.isPending(file.getPath()));
+
+  registry.prepare(file.getPath());
+  registry.wait(file.getPath());
+  CHECK(registry.isPending(file.getPath()));
+
+  // The old version is still known under its previous modification time.
+  boost::filesystem::last_write_time(file.getPath(), modified);
+  CHECK(registry.isPending(file.getPath()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureRegistry does not decode TIFF images") {
+  TemporaryFile   file(".TIF");
+  TextureRegistry registry(std::make_shared<WebMapTextureLoader>(1, 1));
+
+  registry.prepare(file.getPath());
+  CHECK_FALSE(registry.isPending(file.getPath()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TextureRegistry::collect releases decoded images which have not been uploaded") {
+  TemporaryFile   file(".png");
+  TextureRegistry registry(std::make_shared<WebMapTextureLoader>(1, 1));
+
+  registry.prepare(file.getPath());
+  registry.wait(file.getPath());
+  REQUIRE(registry.isPending(file.getPath()));
+
+  registry.collect();
+  CHECK_FALSE(registry.isPending(file.getPath()));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/TimeIndex.hpp"
+
+#include <doctest.h>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+TimeIndex createIndex(std::string const& isoString) {
+  std::vector<TimeInterval> intervals;
+  utils::parseIsoString(isoString, intervals);
+  return TimeIndex(intervals);
+}
+
+boost::posix_time::ptime toTime(std::string const& time) {
+  return boost::posix_time::time_from_string(time);
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TimeIndex merges adjacent intervals with the same duration") {
+  auto index = createIndex("2020-01-10/2020-01-20/P1D,2020-01-01/2020-01-10/P1D");
+
+  CHECK(index.find(toTime("2020-01-15 12:00:00")) == Timestep{0, 14});
+  CHECK(index.offset({0, 0}, 19) == Timestep{0, 19});
+  CHECK_FALSE(index.offset({0, 0}, 20));
+  CHECK(index.getStartTime({0, 19}) == toTime("2020-01-20 00:00:00"));
+  CHECK(index.format({0, 1}, true) == "2020-01-02/2020-01-03");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TimeIndex turns equally spaced points into a sequence") {
+  auto index = createIndex(
+      "2020-01-01T00:00:00Z,2020-01-01T01:00:00Z,2020-01-01T02:00:00Z,2020-01-01T03:00:00Z");
+
+  CHECK(index.getDuration({0, 0}) == 3600);
+  CHECK_FALSE(index.offset({0, 0}, 4));
+
+  // All points including the last one cover the time until the following point would be.
+  CHECK(index.find(toTime("2020-01-01 00:30:00")) == Timestep{0, 0});
+  CHECK(index.find(toTime("2020-01-01 02:30:00")) == Timestep{0, 2});
+  CHECK(index.find(toTime("2020-01-01 03:30:00")) == Timestep{0, 3});
+  CHECK_FALSE(index.find(toTime("2020-01-01 04:00:01")));
+
+  // Points are requested without a timespan.
+  CHECK(index.format({0, 1}, true) == "2020-01-01T01:00:00Z");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TimeIndex keeps points which are not equally spaced") {
+  auto index = createIndex("2000-01-01T00:00:00Z,2060-01-01T00:00:00Z");
+
+  CHECK(index.getDuration({0, 0}) == 0);
+  CHECK(index.getDuration({1, 0}) == 0);
+
+  // Points only cover their own second.
+  CHECK(index.find(toTime("2000-01-01 00:00:00")) == Timestep{0, 0});
+  CHECK_FALSE(index.find(toTime("2000-01-01 00:00:01")));
+  CHECK_FALSE(index.find(toTime("2030-01-01 00:00:00")));
+
+  CHECK(index.getPrevious(toTime("2030-01-01 00:00:00")) == Timestep{0, 0});
+  CHECK(index.getNext(toTime("2030-01-01 00:00:00")) == Timestep{1, 0});
+  CHECK(index.offset({0, 0}, 1) == Timestep{1, 0});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TimeIndex skips gaps between intervals") {
+  auto index = createIndex("2020-01-01/2020-01-02/P1D,2020-01-10/2020-01-11/P1D");
+
+  CHECK_FALSE(index.find(toTime("2020-01-05 00:00:00")));
+  CHECK_FALSE(index.getPrevious(toTime("2019-12-31 00:00:00")));
+  CHECK(index.getPrevious(toTime("2020-01-05 00:00:00")) == Timestep{0, 1});
+  CHECK(index.getPrevious(toTime("2020-01-10 12:00:00")) == Timestep{1, 0});
+
+  CHECK(index.getNext(toTime("2019-12-31 00:00:00")) == Timestep{0, 0});
+  CHECK(index.getNext(toTime("2020-01-01 12:00:00")) == Timestep{0, 1});
+  CHECK(index.getNext(toTime("2020-01-05 00:00:00")) == Timestep{1, 0});
+  CHECK_FALSE(index.getNext(toTime("2020-01-11 00:00:00")));
+
+  CHECK(index.offset({0, 1}, 1) == Timestep{1, 0});
+  CHECK(index.offset({1, 0}, -1) == Timestep{0, 1});
+  CHECK(index.offset({1, 1}, -3) == Timestep{0, 0});
+  CHECK_FALSE(index.offset({1, 1}, 1));
+  CHECK_FALSE(index.offset({0, 0}, -1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("TimeIndex resolves overlapping intervals") {
+  auto index = createIndex("2020-01-01T00:00:00Z/2020-01-01T10:00:00Z/PT1H,"
+                           "2020-01-01T02:30:00Z/2020-01-01T03:00:00Z/PT10M");
+
+  // Inside the short interval, it is preferred as it starts last.
+  CHECK(index.find(toTime("2020-01-01 02:45:00")) == Timestep{1, 1});
+  CHECK(index.getNext(toTime("2020-01-01 02:45:00")) == Timestep{1, 2});
+
+  // After its end, the long interval applies again.
+  CHECK(index.find(toTime("2020-01-01 05:30:00")) == Timestep{0, 5});
+  CHECK(index.getPrevious(toTime("2020-01-01 05:30:00")) == Timestep{0, 5});
+  CHECK(index.getNext(toTime("2020-01-01 03:15:00")) == Timestep{0, 4});
+
+  CHECK_FALSE(index.find(toTime("2020-01-01 11:00:01")));
+  CHECK(index.getPrevious(toTime("2020-01-01 12:00:00")) == Timestep{0, 10});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
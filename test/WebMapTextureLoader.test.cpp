@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/WebMapTextureLoader.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <curlpp/Options.hpp>
+#include <doctest.h>
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include <chrono>
+#include <thread>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+using boost::asio::ip::tcp;
+
+// New connections are delayed by this amount, which roughly corresponds to the round trips of a
+// TCP and TLS handshake with a remote map server.
+const std::chrono::milliseconds HANDSHAKE_DELAY(20);
+
+const int REQUEST_COUNT = 50;
+
+// A minimal HTTP/1.1 server on the loopback interface, which answers every request with the same
+// PNG image. Connections are kept open, so that clients can reuse them.
+class StubWMSServer {
+ public:
+  StubWMSServer()
+      : mAcceptor(mContext, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)) {
+
+    // A 64x64 image is about the size of a small time-series frame.
+    std::vector<unsigned char> pixels(64 * 64 * 4, 128);
+    stbi_write_png_to_func(
+        [](void* context, void* data, int size) {
+          static_cast<std::string*>(context)->append(static_cast<char*>(data), size);
+        },
+        &mImage, 64, 64, 4, pixels.data(), 64 * 4);
+
+    accept();
+    mThread = std::thread([this]() { mContext.run(); });
+  }
+
+  StubWMSServer(StubWMSServer const& other) = delete;
+  StubWMSServer(StubWMSServer&& other)      = delete;
+
+  StubWMSServer& operator=(StubWMSServer const& other) = delete;
+  StubWMSServer& operator=(StubWMSServer&& other) = delete;
+
+  ~StubWMSServer() {
+    mContext.stop();
+    mThread.join();
+  }
+
+  std::string getUrl() const {
+    return "http://127.0.0.1:" + std::to_string(mAcceptor.local_endpoint().port()) +
+           "/wms?SERVICE=WMS&REQUEST=GetMap";
+  }
+
+ private:
+  struct Connection {
+    explicit Connection(boost::asio::io_context& context)
+        : mSocket(context)
+        , mTimer(context) {
+    }
+
+    tcp::socket               mSocket;
+    boost::asio::steady_timer mTimer;
+    boost::asio::streambuf    mRequest;
+    std::string               mResponse;
+  };
+
+  void accept() {
+    auto connection = std::make_shared<Connection>(mContext);
+    mAcceptor.async_accept(connection->mSocket, [this, connection](auto const& error) {
+      if (!error) {
+        connection->mTimer.expires_after(HANDSHAKE_DELAY);
+        connection->mTimer.async_wait([this, connection](auto const&) { read(connection); });
+      }
+      accept();
+    });
+  }
+
+  void read(std::shared_ptr<Connection> const& connection) {
+    boost::asio::async_read_until(connection->mSocket, connection->mRequest, "\r\n\r\n",
+        [this, connection](auto const& error, size_t length) {
+          if (error) {
+            return;
+          }
+
+          connection->mRequest.consume(length);
+          connection->mResponse = "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nContent-Length: " +
+                                  std::to_string(mImage.size()) + "\r\n\r\n" + mImage;
+
+          boost::asio::async_write(connection->mSocket,
+              boost::asio::buffer(connection->mResponse),
+              [this, connection](auto const& error, size_t) {
+                if (!error) {
+                  read(connection);
+                }
+              });
+        });
+  }
+
+  boost::asio::io_context mContext;
+  tcp::acceptor           mAcceptor;
+  std::thread             mThread;
+  std::string             mImage;
+};
+
+// Returns the average time of the given function in milliseconds.
+template <typename F>
+double measure(F&& function) {
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < REQUEST_COUNT; ++i) {
+    function(i);
+  }
+
+  std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+  return duration.count() / REQUEST_COUNT;
+}
+
+// Writes PNG images of a single color to a temporary directory and removes them again.
+class TemporaryImages {
+ public:
+  TemporaryImages()
+      : mDirectory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {
+    boost::filesystem::create_directories(mDirectory);
+  }
+
+  TemporaryImages(TemporaryImages const& other) = delete;
+  TemporaryImages(TemporaryImages&& other)      = delete;
+
+  TemporaryImages& operator=(TemporaryImages const& other) = delete;
+  TemporaryImages& operator=(TemporaryImages&& other) = delete;
+
+  ~TemporaryImages() {
+    boost::system::error_code error;
+    boost::filesystem::remove_all(mDirectory, error);
+  }
+
+  /// Writes an image of the given size and returns its path.
+  std::string create(std::string const& name, int width, int height, unsigned char value) const {
+    std::string                path = getPath(name);
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4, value);
+    REQUIRE(stbi_write_png(path.c_str(), width, height, 4, pixels.data(), width * 4));
+    return path;
+  }
+
+  std::string getPath(std::string const& name) const {
+    return (mDirectory / name).string();
+  }
+
+ private:
+  boost::filesystem::path mDirectory;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("WebMapTextureLoader::loadFileAsync decodes files on the decode threads") {
+  TemporaryImages images;
+  std::string     large = images.create("large.png", 8, 4, 200);
+  std::string     small = images.create("small.png", 1, 1, 100);
+
+  WebMapTextureLoader loader(1, 2);
+  loader.setGenerateMipmaps(true);
+
+  auto handle       = std::make_shared<PriorityThreadPool::TaskHandle>(0);
+  auto largeTexture = loader.loadFileAsync(large, handle);
+  auto smallTexture = loader.loadFileAsync(small, handle);
+  auto missing      = loader.loadFileAsync(images.getPath("missing.png"), handle);
+
+  // 8x4, 4x2, 2x1 and 1x1 pixels.
+  DecodedTexture texture = largeTexture.get();
+  REQUIRE(texture.mData);
+  CHECK(texture.mWidth == 8);
+  CHECK(texture.mHeight == 4);
+  REQUIRE(texture.getLevelCount() == 4);
+  CHECK(texture.getLevelData(3)[0] == 200);
+
+  texture = smallTexture.get();
+  REQUIRE(texture.mData);
+  CHECK(texture.getLevelCount() == 1);
+  CHECK(texture.getLevelData(0)[0] == 100);
+
+  CHECK_FALSE(missing.get().mData);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// This is a benchmark rather than a test, it only runs if skipped tests are enabled. It compares
+// the per-request latency of a new curl handle for each request, as the loader used to do, with
+// the pooled handles of the WebMapTextureLoader. Both download and decode the image.
+TEST_CASE("WebMapTextureLoader reuses connections to the map server" * doctest::skip()) {
+  StubWMSServer server;
+
+  double newConnections = measure([&server](int i) {
+    std::string  data;
+    curlpp::Easy request;
+    request.setOpt(curlpp::options::Url(server.getUrl() + "&TIME=" + std::to_string(i)));
+    request.setOpt(curlpp::options::NoSignal(true));
+    request.setOpt(curlpp::options::WriteFunction([&data](char* ptr, size_t size, size_t nmemb) {
+      data.append(ptr, size * nmemb);
+      return size * nmemb;
+    }));
+    request.perform();
+
+    int            width, height, channels;
+    unsigned char* pixels = stbi_load_from_memory(reinterpret_cast<unsigned char*>(data.data()),
+        static_cast<int>(data.size()), &width, &height, &channels, STBI_rgb_alpha);
+    REQUIRE(pixels);
+    stbi_image_free(pixels);
+  });
+
+  // Each request uses a new time, so that nothing is read from the map cache.
+  auto mapCache = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+  double pooledConnections = 0.0;
+
+  {
+    WebMapTextureLoader loader(1, 1);
+    loader.setGenerateMipmaps(false);
+
+    pooledConnections = measure([&](int i) {
+      auto texture = loader
+                         .loadTextureAsync("2020-01-01T00-00-" + std::to_string(i),
+                             server.getUrl(), "benchmark", mapCache.string(),
+                             std::make_shared<PriorityThreadPool::TaskHandle>(0))
+                         .get();
+      REQUIRE(texture.mData);
+    });
+  }
+
+  boost::filesystem::remove_all(mapCache);
+
+  MESSAGE("New connection per request: " << newConnections << " ms per request");
+  MESSAGE("Pooled connections:         " << pooledConnections << " ms per request");
+
+  CHECK(pooledConnections < newConnections);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies
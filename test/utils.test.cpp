@@ -0,0 +1,327 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR                               //
+//      and may be used under the terms of the MIT license. See the LICENSE file for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR)                       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../src/utils.hpp"
+
+#include <doctest.h>
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <regex>
+#include <sstream>
+
+namespace csp::simplewmsbodies {
+
+namespace {
+
+// The std::regex based parser which was used before. The fuzz test checks that the new parser
+// produces the same results, the benchmark compares the performance of both.
+namespace legacy {
+
+void matchDuration(std::string const& input, std::regex const& re, int& duration) {
+  std::smatch match;
+  std::regex_search(input, match, re);
+
+  if (match.empty()) {
+    return;
+  }
+
+  std::vector<int> vec = {0, 0, 0, 0, 0, 0}; // years, months, days, hours, minutes, seconds
+
+  for (size_t i = 1; i < match.size(); ++i) {
+    if (match[i].matched) {
+      std::string str = match[i];
+      str.pop_back(); // remove last character.
+      vec[i - 1] = static_cast<int>(std::stod(str));
+    }
+  }
+
+  duration = 31556926 * vec[0] + // years
+             2629744 * vec[1] +  // months
+             86400 * vec[2] +    // days
+             3600 * vec[3] +     // hours
+             60 * vec[4] +       // minutes
+             1 * vec[5];         // seconds
+}
+
+void timeDuration(std::string const& isoString, int& duration, std::string& format) {
+  std::regex rshort("^((?!T).)*$");
+  duration = 0;
+  format   = "";
+
+  // Check if isoString matches rshort.
+  if (std::regex_match(isoString, rshort)) // no T (Time) exist
+  {
+    std::regex r("P([[:d:]]+Y)?([[:d:]]+M)?([[:d:]]+D)?");
+    matchDuration(isoString, r, duration);
+  } else {
+    std::regex r("P([[:d:]]+Y)?([[:d:]]+M)?([[:d:]]+D)?T([[:d:]]+H)?([[:d:]]+M)?([[:d:]]+S|[[:d:]]+"
+                 "\\.[[:d:]]+S)?");
+    matchDuration(isoString, r, duration);
+  }
+
+  // Create string format based on interval duration (day / month / year / time).
+  if (duration % 86400 == 0) {
+    format = "%Y-%m-%d";
+  } else if (duration % 2629744 == 0) {
+    format = "%Y-%m";
+  } else if (duration % 31556926 == 0) {
+    format = "%Y";
+  } else {
+    format = "%Y-%m-%dT%H:%MZ";
+  }
+}
+
+void convertIsoDate(std::string& date, boost::posix_time::ptime& time) {
+  date.erase(
+      std::remove_if(date.begin(), date.end(), [](unsigned char x) { return std::ispunct(x); }),
+      date.end());
+
+  std::string dateSubStr = date.substr(0, date.find("T"));
+  std::size_t pos        = date.find("T");
+  std::string timeSubStr = "T";
+
+  if (pos != std::string::npos) {
+    timeSubStr = date.substr(pos);
+  }
+
+  dateSubStr.resize(8, '0');
+  timeSubStr.resize(7, '0');
+  time = boost::posix_time::from_iso_string(dateSubStr + timeSubStr);
+}
+
+void parseIsoString(std::string const& isoString, std::vector<TimeInterval>& timeIntervals) {
+  std::string       timeRange;
+  std::stringstream iso_stringstream(isoString);
+
+  // Read time intervalls.
+  while (std::getline(iso_stringstream, timeRange, ',')) {
+    std::string       startDate, endDate, duration;
+    std::stringstream timeRange_stringstream(timeRange);
+
+    std::getline(timeRange_stringstream, startDate, '/');
+    std::getline(timeRange_stringstream, endDate, '/');
+    std::getline(timeRange_stringstream, duration, '/');
+
+    TimeInterval             tmp;
+    boost::posix_time::ptime start, end;
+    convertIsoDate(startDate, start);
+
+    // If there is no end date, just a single timestep.
+    if (endDate == "") {
+      end                   = start;
+      tmp.mIntervalDuration = 0;
+      tmp.mFormat           = "%Y-%m-%dT%H:%M:%SZ";
+    } else {
+      timeDuration(duration, tmp.mIntervalDuration, tmp.mFormat);
+      convertIsoDate(endDate, end);
+    }
+
+    tmp.mEndTime   = end;
+    tmp.mStartTime = start;
+    timeIntervals.push_back(tmp);
+  }
+}
+
+} // namespace legacy
+
+// Returns a random duration which the legacy parser supports. Its components are in the order
+// required by ISO 8601 and small enough that the legacy parser does not overflow.
+std::string randomDuration(std::mt19937& random) {
+  auto chance = [&random]() { return std::uniform_int_distribution<int>(0, 1)(random) == 1; };
+  auto value  = [&random](int max) {
+    return std::to_string(std::uniform_int_distribution<int>(0, max)(random));
+  };
+
+  std::string result = "P";
+
+  if (chance()) {
+    result += value(20) + "Y";
+  }
+  if (chance()) {
+    result += value(11) + "M";
+  }
+  if (chance()) {
+    result += value(30) + "D";
+  }
+  if (chance()) {
+    result += "T";
+    if (chance()) {
+      result += value(23) + "H";
+    }
+    if (chance()) {
+      result += value(59) + "M";
+    }
+    if (chance()) {
+      result += value(59) + (chance() ? ".5" : "") + "S";
+    }
+  }
+
+  return result;
+}
+
+// Returns a random point in time in one of the formats which the legacy parser supports.
+std::string randomDate(std::mt19937& random) {
+  auto value = [&random](int min, int max, int width) {
+    std::ostringstream stream;
+    stream << std::setw(width) << std::setfill('0')
+           << std::uniform_int_distribution<int>(min, max)(random);
+    return stream.str();
+  };
+
+  std::string year   = value(1900, 2100, 4);
+  std::string month  = value(1, 12, 2);
+  std::string day    = value(1, 28, 2);
+  std::string hour   = value(0, 23, 2);
+  std::string minute = value(0, 59, 2);
+  std::string second = value(0, 59, 2);
+
+  switch (std::uniform_int_distribution<int>(0, 4)(random)) {
+  case 0:
+    return year + "-" + month + "-" + day + "T" + hour + ":" + minute + ":" + second + "Z";
+  case 1:
+    return year + "-" + month + "-" + day + "T" + hour + ":" + minute + ":" + second;
+  case 2:
+    return year + month + day + "T" + hour + minute + second + "Z";
+  case 3:
+    return year + "-" + month + "-" + day;
+  default:
+    return year + month + day;
+  }
+}
+
+// Returns a comma-separated list of the given amount of hourly points in time.
+std::string createTimeList(int count) {
+  boost::posix_time::ptime time(boost::gregorian::date(2000, 1, 1));
+  std::string              result;
+
+  for (int i = 0; i < count; ++i) {
+    if (i > 0) {
+      result += ",";
+    }
+    result += utils::timeToString("%Y-%m-%dT%H:%M:%SZ", time);
+    time += boost::posix_time::hours(1);
+  }
+
+  return result;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("utils::parseDuration") {
+  static_assert(utils::parseDuration("P1D") == 86400);
+  static_assert(utils::parseDuration("PT1H30M") == 5400);
+
+  CHECK(utils::parseDuration("P1Y2M10DT2H30M") == 31556926 + 2 * 2629744 + 10 * 86400 + 9000);
+  CHECK(utils::parseDuration("PT1.5S") == 1);
+  CHECK(utils::parseDuration("P68Y") == 68 * 31556926);
+  CHECK(utils::parseDuration("") == 0);
+  CHECK(utils::parseDuration("P") == 0);
+  CHECK(utils::parseDuration("1D") == 0);
+
+  // Durations which do not fit into an int are rejected.
+  CHECK(utils::parseDuration("P69Y") == 0);
+  CHECK(utils::parseDuration("PT2147483648S") == 0);
+  CHECK(utils::parseDuration("PT99999999999999999999999S") == 0);
+  CHECK(utils::parseDuration("PT2147483647S") == 2147483647);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("utils::parseIsoDate") {
+  constexpr utils::IsoDate date = utils::parseIsoDate("2020-02-03T04:05:06Z");
+  static_assert(date.mYear == 2020 && date.mMonth == 2 && date.mDay == 3);
+  static_assert(date.mHour == 4 && date.mMinute == 5 && date.mSecond == 6);
+
+  utils::IsoDate basic = utils::parseIsoDate("20200203T0405Z");
+  CHECK(basic.mYear == 2020);
+  CHECK(basic.mMonth == 2);
+  CHECK(basic.mDay == 3);
+  CHECK(basic.mHour == 4);
+  CHECK(basic.mMinute == 5);
+  CHECK(basic.mSecond == 0);
+
+  // Missing components default to the start of the month or year.
+  utils::IsoDate month = utils::parseIsoDate("2020-02");
+  CHECK(month.mMonth == 2);
+  CHECK(month.mDay == 1);
+  CHECK(month.mHour == 0);
+
+  CHECK_THROWS([]() {
+    boost::posix_time::ptime time;
+    utils::convertIsoDate("2020-02-30", time);
+  }());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TEST_CASE("utils::parseIsoString produces the same results as the std::regex based parser") {
+  std::mt19937 random(42);
+
+  for (int i = 0; i < 2000; ++i) {
+    std::string input;
+    int         count = std::uniform_int_distribution<int>(1, 5)(random);
+
+    for (int j = 0; j < count; ++j) {
+      if (j > 0) {
+        input += ",";
+      }
+
+      input += randomDate(random);
+
+      if (std::uniform_int_distribution<int>(0, 1)(random) == 1) {
+        input += "/" + randomDate(random) + "/" + randomDuration(random);
+      }
+    }
+
+    std::vector<TimeInterval> expected;
+    std::vector<TimeInterval> actual;
+    legacy::parseIsoString(input, expected);
+    utils::parseIsoString(input, actual);
+
+    INFO(input);
+    REQUIRE(actual.size() == expected.size());
+
+    for (size_t j = 0; j < actual.size(); ++j) {
+      CHECK(actual[j].mStartTime == expected[j].mStartTime);
+      CHECK(actual[j].mEndTime == expected[j].mEndTime);
+      CHECK(actual[j].mIntervalDuration == expected[j].mIntervalDuration);
+      CHECK(actual[j].mFormat == expected[j].mFormat);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// This is a benchmark rather than a test, it only runs if skipped tests are enabled.
+TEST_CASE("utils::parseIsoString benchmark with 100k points in time" * doctest::skip()) {
+  std::string input = createTimeList(100000);
+
+  auto measure = [&input](auto&& parse) {
+    std::vector<TimeInterval> intervals;
+    auto                      start = std::chrono::steady_clock::now();
+    parse(input, intervals);
+    std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+    CHECK(intervals.size() == 100000);
+    return duration.count();
+  };
+
+  double legacyTime = measure(legacy::parseIsoString);
+  double newTime    = measure(utils::parseIsoString);
+
+  MESSAGE("std::regex based parser: " << legacyTime << " ms");
+  MESSAGE("Hand-written parser:     " << newTime << " ms");
+
+  CHECK(newTime < legacyTime);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+} // namespace csp::simplewmsbodies